@@ -0,0 +1,505 @@
+/**
+ * D-Bus Benchmark Load Generator
+ *
+ * Drives one operation against one object at a fixed concurrency: it
+ * keeps `--concurrency` calls in flight and sends the next one as soon as
+ * a reply arrives (a closed loop). Nothing is recorded during
+ * `--warmup`; replies that arrive in the following `--duration` are.
+ *
+ * Operations:
+ *   get:PROP               Properties.Get of PROP on --interface
+ *   set:PROP=T:VALUE       Properties.Set of PROP to a variant of type T
+ *   call:METHOD            METHOD on --interface, without arguments
+ *   call:METHOD(T:V,...)   ... with arguments
+ * where T is one of b, i, u, x, t, d, s (e.g. `set:Counter=x:5`,
+ * `call:Add(x:1)`, `set:Name=s:bench`).
+ *
+ * `--watch=MEMBER` counts the signals named MEMBER that the object sends
+ * during the measurement (PropertiesChanged is matched on the Properties
+ * interface, anything else on --interface). `--cpu=NAME:PID` samples the
+ * CPU time of all of PID's threads over the measurement, and may be
+ * repeated, e.g. for the server and the dbus-daemon.
+ *
+ * The result is one JSON object on stdout:
+ *   {"label": ..., "op": ..., "concurrency": 8, "seconds": 5.0,
+ *    "ops": ..., "errors": ..., "ops_per_sec": ..., "p50_us": ...,
+ *    "p99_us": ..., "max_us": ..., "signals": ..., "signals_per_op": ...,
+ *    "cpu_us_per_op": {"server": ..., "dbus-daemon": ...}}
+ *
+ * Usage:
+ *   ./bus_bench --service=S --path=P --interface=I --op=OP
+ *               [--concurrency=N] [--duration=SEC] [--warmup=SEC]
+ *               [--watch=MEMBER] [--cpu=NAME:PID]... [--label=NAME]
+ *
+ * Defaults: --concurrency=8 --duration=5 --warmup=1
+ *
+ * bench/run_suite.sh runs the standard scenarios on a private bus.
+ */
+
+#include <sdbusplus/asio/connection.hpp>
+#include <sdbusplus/bus/match.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+constexpr auto propertiesInterface = "org.freedesktop.DBus.Properties";
+
+using Clock = std::chrono::steady_clock;
+
+// An argument or property value given on the command line
+using Value = std::variant<bool, int32_t, uint32_t, int64_t, uint64_t, double,
+                           std::string>;
+
+// "T:VALUE" -> Value of D-Bus type T
+Value parseValue(const std::string& text)
+{
+    if (text.size() < 2 || text[1] != ':')
+    {
+        throw std::invalid_argument("expected T:VALUE, got '" + text + "'");
+    }
+    std::string value = text.substr(2);
+    switch (text[0])
+    {
+        case 'b':
+            return value == "true" || value == "1";
+        case 'i':
+            return static_cast<int32_t>(std::stol(value));
+        case 'u':
+            return static_cast<uint32_t>(std::stoul(value));
+        case 'x':
+            return static_cast<int64_t>(std::stoll(value));
+        case 't':
+            return static_cast<uint64_t>(std::stoull(value));
+        case 'd':
+            return std::stod(value);
+        case 's':
+            return value;
+        default:
+            throw std::invalid_argument("unknown type '" + text.substr(0, 1) +
+                                        "'");
+    }
+}
+
+struct Op
+{
+    enum class Kind
+    {
+        get,
+        set,
+        call,
+    };
+    Kind kind;
+    std::string member; // property or method name
+    std::vector<Value> args;
+};
+
+Op parseOp(const std::string& text)
+{
+    auto colon = text.find(':');
+    if (colon == std::string::npos)
+    {
+        throw std::invalid_argument("expected get:, set: or call:");
+    }
+    std::string kind = text.substr(0, colon);
+    std::string rest = text.substr(colon + 1);
+
+    if (kind == "get")
+    {
+        return {Op::Kind::get, rest, {}};
+    }
+    if (kind == "set")
+    {
+        auto equals = rest.find('=');
+        if (equals == std::string::npos)
+        {
+            throw std::invalid_argument("expected set:PROP=T:VALUE");
+        }
+        return {Op::Kind::set,
+                rest.substr(0, equals),
+                {parseValue(rest.substr(equals + 1))}};
+    }
+    if (kind == "call")
+    {
+        auto open = rest.find('(');
+        Op op{Op::Kind::call, rest.substr(0, open), {}};
+        if (open != std::string::npos)
+        {
+            if (rest.back() != ')')
+            {
+                throw std::invalid_argument("missing ')' in " + rest);
+            }
+            std::string list = rest.substr(open + 1, rest.size() - open - 2);
+            size_t begin = 0;
+            while (begin < list.size())
+            {
+                auto comma = list.find(',', begin);
+                comma = comma == std::string::npos ? list.size() : comma;
+                op.args.push_back(
+                    parseValue(list.substr(begin, comma - begin)));
+                begin = comma + 1;
+            }
+        }
+        return op;
+    }
+    throw std::invalid_argument("unknown operation '" + kind + "'");
+}
+
+// CPU time all threads of a process have used so far, in nanoseconds
+std::optional<uint64_t> cpuNanos(pid_t pid)
+{
+    // schedstat has nanosecond resolution, but /proc/<pid>/schedstat is
+    // the main thread's alone, so sum every task's. A thread that exits
+    // during the run drops out of the sum; the services measured here keep
+    // their threads for their whole life.
+    std::string proc = "/proc/" + std::to_string(pid);
+    std::error_code ec;
+    std::filesystem::directory_iterator tasks(proc + "/task", ec);
+    uint64_t total = 0;
+    bool found = false;
+    for (; !ec && tasks != std::filesystem::directory_iterator();
+         tasks.increment(ec))
+    {
+        std::ifstream schedstat(tasks->path() / "schedstat");
+        uint64_t onCpu = 0;
+        if (schedstat >> onCpu)
+        {
+            total += onCpu;
+            found = true;
+        }
+    }
+    if (found)
+    {
+        return total;
+    }
+
+    // Without schedstat, stat's utime and stime, in clock ticks, already
+    // cover the whole process
+    std::ifstream stat(proc + "/stat");
+    std::string line;
+    if (!std::getline(stat, line))
+    {
+        return std::nullopt;
+    }
+    // Fields 14 and 15 (utime, stime) follow the parenthesized comm,
+    // which may itself contain spaces
+    auto close = line.rfind(')');
+    if (close == std::string::npos)
+    {
+        return std::nullopt;
+    }
+    std::istringstream fields(line.substr(close + 2));
+    std::string skip;
+    for (int field = 3; field < 14; ++field)
+    {
+        fields >> skip;
+    }
+    uint64_t utime = 0;
+    uint64_t stime = 0;
+    if (!(fields >> utime >> stime))
+    {
+        return std::nullopt;
+    }
+    return (utime + stime) * 1000000000 / sysconf(_SC_CLK_TCK);
+}
+
+struct CpuProbe
+{
+    std::string name;
+    pid_t pid;
+    std::optional<uint64_t> begin;
+    std::optional<uint64_t> end;
+};
+
+// Value at percentile `p` of `samples` (sorted in place)
+double percentile(std::vector<double>& samples, double p)
+{
+    if (samples.empty())
+    {
+        return 0.0;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto rank = static_cast<size_t>(p / 100.0 * (samples.size() - 1));
+    return samples[rank];
+}
+
+// `text` as a JSON string literal
+std::string jsonString(const std::string& text)
+{
+    std::string out = "\"";
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out + "\"";
+}
+
+int main(int argc, char* argv[])
+{
+    std::string service;
+    std::string path;
+    std::string interface;
+    std::string opText;
+    std::string watch;
+    std::string label;
+    size_t concurrency = 8;
+    double duration = 5.0;
+    double warmup = 1.0;
+    std::vector<CpuProbe> probes;
+    Op op;
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg.starts_with("--service="))
+            {
+                service = arg.substr(10);
+            }
+            else if (arg.starts_with("--path="))
+            {
+                path = arg.substr(7);
+            }
+            else if (arg.starts_with("--interface="))
+            {
+                interface = arg.substr(12);
+            }
+            else if (arg.starts_with("--op="))
+            {
+                opText = arg.substr(5);
+            }
+            else if (arg.starts_with("--concurrency="))
+            {
+                concurrency = std::max<size_t>(std::stoul(arg.substr(14)), 1);
+            }
+            else if (arg.starts_with("--duration="))
+            {
+                duration = std::stod(arg.substr(11));
+            }
+            else if (arg.starts_with("--warmup="))
+            {
+                warmup = std::stod(arg.substr(9));
+            }
+            else if (arg.starts_with("--watch="))
+            {
+                watch = arg.substr(8);
+            }
+            else if (arg.starts_with("--cpu="))
+            {
+                auto spec = arg.substr(6);
+                auto colon = spec.rfind(':');
+                if (colon == std::string::npos)
+                {
+                    throw std::invalid_argument("expected --cpu=NAME:PID");
+                }
+                probes.push_back({spec.substr(0, colon),
+                                  static_cast<pid_t>(
+                                      std::stol(spec.substr(colon + 1))),
+                                  std::nullopt, std::nullopt});
+            }
+            else if (arg.starts_with("--label="))
+            {
+                label = arg.substr(8);
+            }
+            else
+            {
+                throw std::invalid_argument("unknown option " + arg);
+            }
+        }
+        if (service.empty() || path.empty() || interface.empty() ||
+            opText.empty())
+        {
+            throw std::invalid_argument(
+                "--service, --path, --interface and --op are required");
+        }
+        op = parseOp(opText);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    boost::asio::io_context io;
+    auto conn = std::make_shared<sdbusplus::asio::connection>(io);
+
+    bool measuring = false;
+    bool stopping = false;
+    size_t inFlight = 0;
+    size_t ops = 0;
+    size_t errors = 0;     // while measuring
+    bool reported = false; // first error printed, warmup included
+    uint64_t signals = 0;
+    std::vector<double> micros;
+
+    std::optional<sdbusplus::bus::match_t> match;
+    if (!watch.empty())
+    {
+        namespace rules = sdbusplus::bus::match::rules;
+        match.emplace(
+            *conn,
+            rules::type::signal() + rules::path(path) +
+                rules::interface(watch == "PropertiesChanged"
+                                     ? propertiesInterface
+                                     : interface) +
+                rules::member(watch),
+            [&](sdbusplus::message_t&) { signals += measuring; });
+    }
+
+    auto newCall = [&]() {
+        bool property = op.kind != Op::Kind::call;
+        auto msg = conn->new_method_call(
+            service.c_str(), path.c_str(),
+            property ? propertiesInterface : interface.c_str(),
+            op.kind == Op::Kind::get   ? "Get"
+            : op.kind == Op::Kind::set ? "Set"
+                                       : op.member.c_str());
+        if (property)
+        {
+            msg.append(interface, op.member);
+        }
+        if (op.kind == Op::Kind::set)
+        {
+            // Sent as a variant of the value's own type
+            msg.append(op.args.front());
+        }
+        else
+        {
+            for (const auto& arg : op.args)
+            {
+                std::visit([&msg](const auto& value) { msg.append(value); },
+                           arg);
+            }
+        }
+        return msg;
+    };
+
+    std::function<void()> issue = [&]() {
+        auto msg = newCall();
+        auto sent = Clock::now();
+        ++inFlight;
+        conn->async_send(msg, [&, sent](boost::system::error_code ec,
+                                        sdbusplus::message_t& reply) {
+            --inFlight;
+            bool ok = !ec && !reply.is_method_error();
+            if (!ok && !reported)
+            {
+                reported = true;
+                std::cerr << "First error: "
+                          << (ec ? ec.message() : "method error") << "\n";
+            }
+            if (measuring)
+            {
+                ++ops;
+                errors += !ok;
+                micros.push_back(std::chrono::duration<double, std::micro>(
+                                     Clock::now() - sent)
+                                     .count());
+            }
+            if (!stopping)
+            {
+                issue();
+            }
+            else if (inFlight == 0)
+            {
+                io.stop();
+            }
+        });
+    };
+
+    auto sampleCpu = [&probes](bool begin) {
+        for (auto& probe : probes)
+        {
+            (begin ? probe.begin : probe.end) = cpuNanos(probe.pid);
+        }
+    };
+
+    Clock::time_point measureFrom;
+    Clock::time_point measureTo;
+    auto seconds = [](double s) {
+        return std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(s));
+    };
+    boost::asio::steady_timer phase(io);
+    phase.expires_after(seconds(warmup));
+    phase.async_wait([&](const boost::system::error_code&) {
+        sampleCpu(true);
+        measuring = true;
+        measureFrom = Clock::now();
+        phase.expires_after(seconds(duration));
+        phase.async_wait([&](const boost::system::error_code&) {
+            measureTo = Clock::now();
+            measuring = false;
+            sampleCpu(false);
+            // Let the calls in flight finish without replacing them
+            stopping = true;
+            if (inFlight == 0)
+            {
+                io.stop();
+            }
+        });
+    });
+
+    for (size_t i = 0; i < concurrency; ++i)
+    {
+        issue();
+    }
+    io.run();
+
+    double elapsed =
+        std::chrono::duration<double>(measureTo - measureFrom).count();
+    double p50 = percentile(micros, 50);
+    double p99 = percentile(micros, 99);
+    double max = micros.empty() ? 0.0 : micros.back();
+    double perOp = ops == 0 ? 0.0 : 1.0 / static_cast<double>(ops);
+
+    std::printf("{\"label\": %s, \"service\": %s, \"op\": %s, "
+                "\"concurrency\": %zu, \"seconds\": %.3f, \"ops\": %zu, "
+                "\"errors\": %zu, \"ops_per_sec\": %.1f, \"p50_us\": %.1f, "
+                "\"p99_us\": %.1f, \"max_us\": %.1f",
+                jsonString(label).c_str(), jsonString(service).c_str(),
+                jsonString(opText).c_str(), concurrency, elapsed, ops, errors,
+                elapsed > 0 ? static_cast<double>(ops) / elapsed : 0.0, p50,
+                p99, max);
+    if (!watch.empty())
+    {
+        std::printf(", \"signals\": %llu, \"signals_per_op\": %.3f",
+                    static_cast<unsigned long long>(signals),
+                    static_cast<double>(signals) * perOp);
+    }
+    std::printf(", \"cpu_us_per_op\": {");
+    for (size_t i = 0; i < probes.size(); ++i)
+    {
+        const auto& probe = probes[i];
+        std::printf("%s%s: ", i == 0 ? "" : ", ", jsonString(probe.name).c_str());
+        if (probe.begin && probe.end && ops > 0)
+        {
+            std::printf("%.2f",
+                        static_cast<double>(*probe.end - *probe.begin) /
+                            1000.0 * perOp);
+        }
+        else
+        {
+            std::printf("null");
+        }
+    }
+    std::printf("}}\n");
+    return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+#!/bin/bash
+# End-to-end D-Bus benchmark suite
+#
+# Starts a private dbus-daemon, runs each service on it in turn and
+# drives it with bus_bench at every concurrency level. Each run prints
+# one JSON object (JSON Lines) on stdout and appends it to --out; the
+# fields are described in bench/bus_bench.cpp. Server and dbus-daemon
+# CPU time are reported per operation.
+#
+# Usage:
+#   bench/run_suite.sh [--builddir=DIR] [--virtual-sensor=PATH]
+#                      [--greeting=PATH] [--concurrency="1 8 32"]
+#                      [--duration=SEC] [--warmup=SEC] [--out=FILE]
+#
+# dbus_server and bus_bench are taken from --builddir (default
+# ./builddir). virtual_sensor (../sensors) and example-greeting
+# (../custom-dbus-service) are built by their own projects; their
+# scenarios run only when the path to a binary is given.
+set -e
+
+BUILDDIR=./builddir
+VIRTUAL_SENSOR=
+GREETING=
+CONCURRENCY="1 8 32"
+DURATION=5
+WARMUP=1
+OUT=bench-results.jsonl
+
+for ARG in "$@"; do
+    case "$ARG" in
+        --builddir=*) BUILDDIR="${ARG#*=}" ;;
+        --virtual-sensor=*) VIRTUAL_SENSOR="${ARG#*=}" ;;
+        --greeting=*) GREETING="${ARG#*=}" ;;
+        --concurrency=*) CONCURRENCY="${ARG#*=}" ;;
+        --duration=*) DURATION="${ARG#*=}" ;;
+        --warmup=*) WARMUP="${ARG#*=}" ;;
+        --out=*) OUT="${ARG#*=}" ;;
+        *) echo "Unknown option: $ARG" >&2; exit 1 ;;
+    esac
+done
+
+BENCH="$BUILDDIR/bus_bench"
+: > "$OUT"
+
+# Private bus, like entrypoint.sh's dbus-run-session, but with a PID to
+# sample. The services use the system bus, so point it here too.
+ADDRESS_FILE=$(mktemp)
+dbus-daemon --session --nofork --print-address=3 3> "$ADDRESS_FILE" &
+DAEMON_PID=$!
+SERVER_PID=
+cleanup() {
+    [ -n "$SERVER_PID" ] && kill "$SERVER_PID" 2>/dev/null
+    kill "$DAEMON_PID" 2>/dev/null
+    rm -f "$ADDRESS_FILE"
+}
+trap cleanup EXIT
+until [ -s "$ADDRESS_FILE" ]; do sleep 0.05; done
+export DBUS_SESSION_BUS_ADDRESS=$(head -n 1 "$ADDRESS_FILE")
+export DBUS_SYSTEM_BUS_ADDRESS="$DBUS_SESSION_BUS_ADDRESS"
+
+# start SERVICE COMMAND...: run COMMAND and wait until it owns SERVICE
+start() {
+    local SERVICE=$1
+    shift
+    "$@" > /dev/null &
+    SERVER_PID=$!
+    for _ in $(seq 100); do
+        if dbus-send --session --print-reply --dest=org.freedesktop.DBus \
+            /org/freedesktop/DBus org.freedesktop.DBus.NameHasOwner \
+            string:"$SERVICE" | grep -q "boolean true"; then
+            return
+        fi
+        sleep 0.05
+    done
+    echo "$SERVICE did not start" >&2
+    exit 1
+}
+
+stop() {
+    kill "$SERVER_PID" 2>/dev/null || true
+    wait "$SERVER_PID" 2>/dev/null || true
+    SERVER_PID=
+}
+
+# run LABEL SERVICE PATH INTERFACE BUS_BENCH_ARGS...: every concurrency
+run() {
+    local LABEL=$1 SERVICE=$2 OBJECT=$3 IFACE=$4
+    shift 4
+    for C in $CONCURRENCY; do
+        # A run with errors still reports them; keep going
+        "$BENCH" --label="$LABEL" --service="$SERVICE" --path="$OBJECT" \
+            --interface="$IFACE" --concurrency="$C" --duration="$DURATION" \
+            --warmup="$WARMUP" --cpu=server:"$SERVER_PID" \
+            --cpu=dbus-daemon:"$DAEMON_PID" "$@" | tee -a "$OUT" || true
+    done
+}
+
+SERVICE="xyz.openbmc_project.Example.Server"
+OBJECT="/xyz/openbmc_project/example/server"
+IFACE="xyz.openbmc_project.Example.Counter"
+start $SERVICE "$BUILDDIR/dbus_server" --quiet
+run counter-get $SERVICE $OBJECT $IFACE --op=get:Counter
+run counter-set $SERVICE $OBJECT $IFACE --op=set:Counter=x:1 \
+    --watch=PropertiesChanged
+run counter-increment $SERVICE $OBJECT $IFACE --op=call:Increment \
+    --watch=PropertiesChanged
+stop
+
+if [ -n "$VIRTUAL_SENSOR" ]; then
+    # Default Total_Power sensor; its PSU inputs are absent, so Value is NaN
+    SERVICE="xyz.openbmc_project.VirtualSensor.TotalPower"
+    OBJECT="/xyz/openbmc_project/sensors/power/Total_Power"
+    IFACE="xyz.openbmc_project.Sensor.Value"
+    start $SERVICE "$VIRTUAL_SENSOR"
+    run sensor-get $SERVICE $OBJECT $IFACE --op=get:Value
+    stop
+fi
+
+if [ -n "$GREETING" ]; then
+    SERVICE="xyz.openbmc_project.Example.Greeting"
+    OBJECT="/xyz/openbmc_project/example/greeting"
+    IFACE="xyz.openbmc_project.Example.Greeting"
+    start $SERVICE "$GREETING"
+    run greeting-get $SERVICE $OBJECT $IFACE --op=get:Name
+    run greeting-set $SERVICE $OBJECT $IFACE --op=set:Name=s:bench \
+        --watch=PropertiesChanged
+    run greeting-greet $SERVICE $OBJECT $IFACE --op=call:Greet \
+        --watch=Greeted
+    stop
+fi
+
+echo "Results written to $OUT" >&2
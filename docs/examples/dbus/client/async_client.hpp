@@ -0,0 +1,327 @@
+/**
+ * Coroutine D-Bus Client
+ *
+ * bus.call() blocks until the reply arrives, so a client that needs three
+ * values waits for three round trips one after another. AsyncClient makes
+ * each call an awaitable on a sdbusplus::asio::connection, and whenAll()
+ * runs several at once, so a workflow takes as long as its slowest call
+ * rather than the sum of all of them.
+ *
+ *   AsyncClient client(conn);
+ *   auto [state, paths] = co_await whenAll(
+ *       client.getProperty<std::string>({}, service, path, iface, "State"),
+ *       client.call<std::vector<std::string>>({}, mapper, mapperPath,
+ *                                             mapperIface, "GetSubTreePaths",
+ *                                             root, 0, interfaces));
+ *   std::cout << state.get();  // rethrows if that call failed
+ *
+ * Every call takes CallOptions:
+ *   - timeout: a deadline for that call alone, enforced by sd-bus, which
+ *     fails it with ETIMEDOUT (org.freedesktop.DBus.Error.Timeout);
+ *   - cancellation: a Cancellation shared by any number of calls. Its
+ *     cancel() drops their pending replies and fails them at once with
+ *     operation_aborted, e.g. when a whole workflow runs out of time.
+ * A call that gets an error reply throws sdbusplus::exception::SdBusError
+ * with the D-Bus error name, as bus.call() does.
+ *
+ * Everything runs on the connection's io_context thread.
+ */
+
+#pragma once
+
+#include <sdbusplus/asio/connection.hpp>
+#include <sdbusplus/exception.hpp>
+#include <sdbusplus/message.hpp>
+#include <systemd/sd-bus.h>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/this_coro.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/system/system_error.hpp>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+// Cancels every call it was passed to that is still waiting for a reply
+class Cancellation
+{
+  public:
+    Cancellation() = default;
+    Cancellation(const Cancellation&) = delete;
+    Cancellation& operator=(const Cancellation&) = delete;
+
+    void cancel()
+    {
+        cancelled_ = true;
+        auto pending = std::move(pending_);
+        pending_.clear();
+        for (auto& [id, abort] : pending)
+        {
+            abort();
+        }
+    }
+
+    bool cancelled() const
+    {
+        return cancelled_;
+    }
+
+  private:
+    friend class AsyncClient;
+
+    size_t add(std::function<void()> abort)
+    {
+        pending_.emplace(++lastId_, std::move(abort));
+        return lastId_;
+    }
+
+    void remove(size_t id)
+    {
+        pending_.erase(id);
+    }
+
+    bool cancelled_ = false;
+    size_t lastId_ = 0;
+    std::map<size_t, std::function<void()>> pending_;
+};
+
+struct CallOptions
+{
+    std::chrono::microseconds timeout{0}; // 0: the bus default, 25 s
+    Cancellation* cancellation = nullptr;
+};
+
+// The result of one branch of whenAll(): a value or the exception
+template <typename T>
+struct Outcome
+{
+    using Value = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+    std::optional<Value> value;
+    std::exception_ptr error;
+
+    explicit operator bool() const
+    {
+        return !error;
+    }
+
+    // The value, or the exception rethrown
+    const Value& get() const
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+        return *value;
+    }
+};
+
+// Runs every awaitable at once and returns when all have finished. A
+// failure is kept in its Outcome and does not stop the others.
+template <typename... T>
+boost::asio::awaitable<std::tuple<Outcome<T>...>>
+    whenAll(boost::asio::awaitable<T>... tasks)
+{
+    auto executor = co_await boost::asio::this_coro::executor;
+    std::tuple<Outcome<T>...> outcomes;
+    size_t remaining = sizeof...(T);
+
+    // Signalled by cancelling it when the last task finishes
+    boost::asio::steady_timer done(executor,
+                                   boost::asio::steady_timer::time_point::max());
+
+    std::tuple<boost::asio::awaitable<T>...> pending(std::move(tasks)...);
+    [&]<size_t... I>(std::index_sequence<I...>) {
+        (boost::asio::co_spawn(
+             executor, std::move(std::get<I>(pending)),
+             [&](std::exception_ptr error, auto... value) {
+                 auto& outcome = std::get<I>(outcomes);
+                 if (error)
+                 {
+                     outcome.error = error;
+                 }
+                 else
+                 {
+                     outcome.value.emplace(std::move(value)...);
+                 }
+                 if (--remaining == 0)
+                 {
+                     done.cancel();
+                 }
+             }),
+         ...);
+    }(std::index_sequence_for<T...>{});
+
+    if (remaining > 0)
+    {
+        boost::system::error_code ec;
+        co_await done.async_wait(
+            boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    }
+    co_return outcomes;
+}
+
+class AsyncClient
+{
+  public:
+    explicit AsyncClient(std::shared_ptr<sdbusplus::asio::connection> conn) :
+        conn_(std::move(conn))
+    {}
+
+    // Completes with (exception_ptr, reply): null and the reply, or the
+    // error reply as SdBusError, or operation_aborted when cancelled
+    template <typename CompletionToken>
+    auto asyncSend(sdbusplus::message_t& msg, CallOptions options,
+                   CompletionToken&& token)
+    {
+        using Signature = void(std::exception_ptr, sdbusplus::message_t);
+        return boost::asio::async_initiate<CompletionToken, Signature>(
+            [this, &msg, options](auto handler) {
+                using Handler = decltype(handler);
+                auto* pending = new Pending<Handler>{std::move(handler),
+                                                     nullptr,
+                                                     options.cancellation, 0};
+                if (options.cancellation != nullptr)
+                {
+                    if (options.cancellation->cancelled())
+                    {
+                        pending->complete(aborted(), sdbusplus::message_t());
+                        return;
+                    }
+                    pending->id = options.cancellation->add([pending] {
+                        pending->complete(aborted(), sdbusplus::message_t());
+                    });
+                }
+
+                int r = sd_bus_call_async(
+                    conn_->get(), &pending->slot, msg.get(),
+                    &Pending<Handler>::onReply, pending,
+                    static_cast<uint64_t>(options.timeout.count()));
+                if (r < 0)
+                {
+                    pending->complete(
+                        std::make_exception_ptr(boost::system::system_error(
+                            -r, boost::system::generic_category(),
+                            "sd_bus_call_async")),
+                        sdbusplus::message_t());
+                }
+            },
+            token);
+    }
+
+    // Sends `msg` and returns the reply
+    boost::asio::awaitable<sdbusplus::message_t>
+        send(sdbusplus::message_t msg, CallOptions options = {})
+    {
+        co_return co_await asyncSend(msg, options, boost::asio::use_awaitable);
+    }
+
+    // Calls `method` and returns its reply read as `Ret`: nothing for void,
+    // the reply itself for sdbusplus::message_t (to decode with
+    // reply_view.hpp)
+    template <typename Ret = void, typename... Args>
+    boost::asio::awaitable<Ret> call(CallOptions options, std::string service,
+                                     std::string path, std::string interface,
+                                     std::string method, Args... args)
+    {
+        auto msg = conn_->new_method_call(service.c_str(), path.c_str(),
+                                          interface.c_str(), method.c_str());
+        if constexpr (sizeof...(Args) > 0)
+        {
+            msg.append(args...);
+        }
+        auto reply = co_await send(std::move(msg), options);
+        if constexpr (std::is_same_v<Ret, sdbusplus::message_t>)
+        {
+            co_return reply;
+        }
+        else if constexpr (!std::is_void_v<Ret>)
+        {
+            Ret result{};
+            reply.read(result);
+            co_return result;
+        }
+    }
+
+    template <typename T>
+    boost::asio::awaitable<T> getProperty(CallOptions options,
+                                          std::string service, std::string path,
+                                          std::string interface,
+                                          std::string property)
+    {
+        auto value = co_await call<std::variant<T>>(
+            options, std::move(service), std::move(path),
+            "org.freedesktop.DBus.Properties", "Get", std::move(interface),
+            std::move(property));
+        co_return std::get<T>(value);
+    }
+
+  private:
+    static std::exception_ptr aborted()
+    {
+        return std::make_exception_ptr(boost::system::system_error(
+            boost::asio::error::operation_aborted));
+    }
+
+    // One call in flight. Whichever comes first, the reply or
+    // cancellation, completes it; releasing the slot makes sure the other
+    // never arrives.
+    template <typename Handler>
+    struct Pending
+    {
+        Handler handler;
+        sd_bus_slot* slot;
+        Cancellation* cancellation;
+        size_t id;
+
+        void complete(std::exception_ptr error, sdbusplus::message_t reply)
+        {
+            if (cancellation != nullptr)
+            {
+                cancellation->remove(id);
+            }
+            sd_bus_slot_unref(slot);
+
+            // Resumed from the io_context, not from inside sd-bus
+            auto executor = boost::asio::get_associated_executor(handler);
+            boost::asio::post(executor, [handler = std::move(handler), error,
+                                         reply = std::move(reply)]() mutable {
+                std::move(handler)(error, std::move(reply));
+            });
+            delete this;
+        }
+
+        static int onReply(sd_bus_message* m, void* userdata, sd_bus_error*)
+        {
+            auto* self = static_cast<Pending*>(userdata);
+            sdbusplus::message_t reply(m);
+            std::exception_ptr error;
+            if (sd_bus_message_is_method_error(m, nullptr) > 0)
+            {
+                // SdBusError takes over the copy
+                sd_bus_error copy = SD_BUS_ERROR_NULL;
+                sd_bus_error_copy(&copy, sd_bus_message_get_error(m));
+                error = std::make_exception_ptr(
+                    sdbusplus::exception::SdBusError(&copy, "method call"));
+            }
+            self->complete(error, std::move(reply));
+            return 1;
+        }
+    };
+
+    std::shared_ptr<sdbusplus::asio::connection> conn_;
+};
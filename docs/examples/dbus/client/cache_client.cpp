@@ -0,0 +1,167 @@
+/**
+ * D-Bus Property Cache Example
+ *
+ * Demonstrates how to:
+ * - Load a service's objects once with GetManagedObjects
+ * - Keep them current from PropertiesChanged and InterfacesAdded/Removed
+ *   (property_cache.hpp)
+ * - Read properties locally instead of with a Get per read
+ *
+ * It watches dbus_server's objects under /xyz/openbmc_project/example and
+ * prints the cached Counter once a second, along with the number of calls
+ * and signals the cache has handled, so the counter follows Increment
+ * calls made with busctl without a single extra Get. Once the data has
+ * arrived it also times cached reads against a Get round trip.
+ *
+ * Build with SDK:
+ *   $CXX -std=c++20 cache_client.cpp -o cache_client \
+ *       $(pkg-config --cflags --libs sdbusplus)
+ *
+ * Usage (start `dbus_server` first):
+ *   ./cache_client [--seconds=N]    # default 10
+ */
+
+#include <sdbusplus/asio/connection.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include "property_cache.hpp"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <variant>
+
+constexpr auto serviceName = "xyz.openbmc_project.Example.Server";
+constexpr auto objectPath = "/xyz/openbmc_project/example/server";
+constexpr auto interfaceName = "xyz.openbmc_project.Example.Counter";
+constexpr auto managerPath = "/xyz/openbmc_project/example";
+
+using Clock = std::chrono::steady_clock;
+
+// Nanoseconds per cached read, over `reads` reads
+double timeCachedReads(const PropertyCache::Property<int64_t>& counter,
+                       size_t reads)
+{
+    int64_t sum = 0;
+    auto start = Clock::now();
+    for (size_t i = 0; i < reads; ++i)
+    {
+        const int64_t* value = counter.get();
+        sum += value ? *value : 0;
+        // Keep the compiler from hoisting the read out of the loop
+        asm volatile("" : "+r"(sum));
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start)
+               .count() /
+           static_cast<double>(reads);
+}
+
+void printUsage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [--seconds=N]\n"
+              << "  --seconds=N         how long to run, default 10\n";
+}
+
+int main(int argc, char* argv[])
+{
+    int seconds = 10;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        try
+        {
+            if (arg.starts_with("--seconds="))
+            {
+                seconds = std::stoi(arg.substr(10));
+            }
+            else
+            {
+                std::cerr << "Unknown option: " << arg << "\n";
+                return 1;
+            }
+        }
+        catch (const std::logic_error&) // from std::stoi
+        {
+            std::cerr << "Invalid value: " << arg << "\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    boost::asio::io_context io;
+    auto conn = std::make_shared<sdbusplus::asio::connection>(io);
+
+    // ========================================
+    // Watch the service and take a view
+    // ========================================
+    PropertyCache cache(conn);
+    cache.watchManaged(serviceName, managerPath);
+    auto counter = cache.property<int64_t>(serviceName, objectPath,
+                                           interfaceName, "Counter");
+
+    bool timed = false;
+    int tick = 0;
+    boost::asio::steady_timer timer(io);
+    std::function<void()> report = [&]() {
+        const auto& stats = cache.stats();
+        std::cout << "Counter = ";
+        if (const int64_t* value = counter.get())
+        {
+            std::cout << *value;
+        }
+        else
+        {
+            std::cout << "(not loaded)";
+        }
+        std::cout << "   calls " << stats.calls << ", signals "
+                  << stats.signals << ", failures " << stats.failures
+                  << "\n";
+
+        // ========================================
+        // Cached read vs Get round trip, once
+        // ========================================
+        if (counter.get() && !timed)
+        {
+            timed = true;
+            std::cout << "Cached read: " << timeCachedReads(counter, 10000000)
+                      << " ns\n";
+            auto sent = Clock::now();
+            conn->async_method_call(
+                [sent](const boost::system::error_code& ec,
+                       const std::variant<int64_t>&) {
+                    if (!ec)
+                    {
+                        std::cout << "Get round trip: "
+                                  << std::chrono::duration<double, std::nano>(
+                                         Clock::now() - sent)
+                                         .count()
+                                  << " ns\n";
+                    }
+                },
+                serviceName, objectPath, "org.freedesktop.DBus.Properties",
+                "Get", interfaceName, "Counter");
+        }
+
+        if (++tick > seconds)
+        {
+            io.stop();
+            return;
+        }
+        timer.expires_after(std::chrono::seconds(1));
+        timer.async_wait([&](const boost::system::error_code&) { report(); });
+    };
+
+    timer.expires_after(std::chrono::milliseconds(100));
+    timer.async_wait([&](const boost::system::error_code&) { report(); });
+
+    std::cout << "Watching " << serviceName << " under " << managerPath
+              << ". Try:\n";
+    std::cout << "  busctl call " << serviceName << " " << objectPath << " "
+              << interfaceName << " Increment\n\n";
+    io.run();
+
+    return 0;
+}
@@ -5,7 +5,24 @@
  * - Connect to the system bus
  * - Read properties from D-Bus objects
  * - Call D-Bus methods
- * - Monitor property changes
+ * - Issue independent calls concurrently with coroutines
+ *   (async_client.hpp), each with its own deadline
+ * - Cancel a whole workflow that runs out of time
+ *
+ * Examples 1-3 do not depend on each other, so they are sent together and
+ * whenAll() waits for the last reply: the workflow takes as long as the
+ * slowest call, not the sum of the three round trips. Example 4 needs the
+ * service name before it can read the sensor, so its two calls stay in
+ * order. A failed call is reported on its own without stopping the
+ * others.
+ *
+ * The sensor list can hold thousands of paths, so Example 3 reads them as
+ * string_views into the reply (reply_view.hpp) instead of copying each
+ * into a std::string; decode_bench.cpp measures the difference.
+ *
+ * Each read here is a round trip. Code that reads the same properties
+ * repeatedly should cache them instead (property_cache.hpp,
+ * cache_client.cpp).
  *
  * Source Reference:
  *   - sdbusplus library: https://github.com/openbmc/sdbusplus
@@ -15,15 +32,39 @@
  * Build with SDK:
  *   $CXX -std=c++20 dbus_client.cpp -o dbus_client \
  *       $(pkg-config --cflags --libs sdbusplus)
+ *
+ * Usage:
+ *   ./dbus_client [--timeout=MS]     # deadline per call, default 2000
+ *                 [--deadline=MS]    # for the whole run, default 5000
  */
 
-#include <sdbusplus/bus.hpp>
-#include <sdbusplus/message.hpp>
+#include <sdbusplus/asio/connection.hpp>
+#include <sdbusplus/exception.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include "async_client.hpp"
+#include "reply_view.hpp"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
-#include <variant>
+#include <map>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <variant>
 #include <vector>
-#include <map>
+
+constexpr auto hostService = "xyz.openbmc_project.State.Host";
+constexpr auto hostPath = "/xyz/openbmc_project/state/host0";
+constexpr auto hostInterface = "xyz.openbmc_project.State.Host";
+constexpr auto mapperService = "xyz.openbmc_project.ObjectMapper";
+constexpr auto mapperPath = "/xyz/openbmc_project/object_mapper";
+constexpr auto mapperInterface = "xyz.openbmc_project.ObjectMapper";
+
+using Clock = std::chrono::steady_clock;
+using PropertyMap = std::map<
+    std::string, std::variant<std::string, int64_t, uint64_t, double, bool>>;
 
 // Helper to print variant values
 void printVariant(const std::variant<std::string, int64_t, uint64_t,
@@ -34,152 +75,228 @@ void printVariant(const std::variant<std::string, int64_t, uint64_t,
     }, value);
 }
 
-int main()
+// Prints why a call failed
+void printError(const std::exception_ptr& error)
 {
     try
     {
-        // Connect to system bus
-        auto bus = sdbusplus::bus::new_default();
-        std::cout << "Connected to D-Bus system bus\n\n";
-
-        // ========================================
-        // Example 1: Read a property
-        // ========================================
-        std::cout << "=== Reading Host State ===\n";
-
-        auto getMethod = bus.new_method_call(
-            "xyz.openbmc_project.State.Host",       // Service name
-            "/xyz/openbmc_project/state/host0",     // Object path
-            "org.freedesktop.DBus.Properties",      // Interface
-            "Get"                                    // Method
-        );
-
-        // Arguments: interface name, property name
-        getMethod.append("xyz.openbmc_project.State.Host",
-                        "CurrentHostState");
-
-        auto reply = bus.call(getMethod);
-
-        std::variant<std::string> hostState;
-        reply.read(hostState);
+        std::rethrow_exception(error);
+    }
+    catch (const sdbusplus::exception::exception& e)
+    {
+        std::cerr << "D-Bus error: " << e.what() << "\n";
+        std::cerr << "Name: " << e.name() << "\n";
+        std::cerr << "Description: " << e.description() << "\n";
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << "\n";
+    }
+}
 
-        std::cout << "Current Host State: "
-                  << std::get<std::string>(hostState) << "\n\n";
+double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start)
+        .count();
+}
 
-        // ========================================
+// Runs the examples; returns the number of calls that failed
+boost::asio::awaitable<int> run(AsyncClient& client, CallOptions options)
+{
+    int failures = 0;
+    auto start = Clock::now();
+
+    // ========================================
+    // Examples 1-3: Independent reads, together
+    // ========================================
+    std::vector<std::string> valueInterfaces = {
+        "xyz.openbmc_project.Sensor.Value"};
+    auto [hostState, properties, sensors] = co_await whenAll(
+        // Example 1: Read a property
+        client.getProperty<std::string>(options, hostService, hostPath,
+                                        hostInterface, "CurrentHostState"),
         // Example 2: Get all properties
-        // ========================================
-        std::cout << "=== Getting All Properties ===\n";
-
-        auto getAllMethod = bus.new_method_call(
-            "xyz.openbmc_project.State.Host",
-            "/xyz/openbmc_project/state/host0",
-            "org.freedesktop.DBus.Properties",
-            "GetAll"
-        );
-
-        getAllMethod.append("xyz.openbmc_project.State.Host");
-
-        auto allReply = bus.call(getAllMethod);
-
-        using PropertyMap = std::map<std::string,
-            std::variant<std::string, int64_t, uint64_t, double, bool>>;
-        PropertyMap properties;
-        allReply.read(properties);
+        client.call<PropertyMap>(options, hostService, hostPath,
+                                 "org.freedesktop.DBus.Properties", "GetAll",
+                                 std::string(hostInterface)),
+        // Example 3: Use Object Mapper. Arguments: root path, depth
+        // (0 = all), interfaces
+        client.call<sdbusplus::message_t>(
+            options, mapperService, mapperPath, mapperInterface,
+            "GetSubTreePaths", std::string("/xyz/openbmc_project/sensors"), 0,
+            valueInterfaces));
+    double fanOut = millisecondsSince(start);
+
+    std::cout << "=== Reading Host State ===\n";
+    if (hostState)
+    {
+        std::cout << "Current Host State: " << hostState.get() << "\n\n";
+    }
+    else
+    {
+        printError(hostState.error);
+        ++failures;
+    }
 
-        for (const auto& [name, value] : properties)
+    std::cout << "=== Getting All Properties ===\n";
+    if (properties)
+    {
+        for (const auto& [name, value] : properties.get())
         {
             std::cout << "  " << name << " = ";
             printVariant(value);
             std::cout << "\n";
         }
         std::cout << "\n";
+    }
+    else
+    {
+        printError(properties.error);
+        ++failures;
+    }
 
-        // ========================================
-        // Example 3: Use Object Mapper
-        // ========================================
-        std::cout << "=== Finding Sensors via Object Mapper ===\n";
-
-        auto mapperMethod = bus.new_method_call(
-            "xyz.openbmc_project.ObjectMapper",
-            "/xyz/openbmc_project/object_mapper",
-            "xyz.openbmc_project.ObjectMapper",
-            "GetSubTreePaths"
-        );
-
-        // Arguments: path, depth, interfaces
-        mapperMethod.append("/xyz/openbmc_project/sensors");  // Root path
-        mapperMethod.append(0);                                // Depth (0 = all)
-        std::vector<std::string> interfaces = {
-            "xyz.openbmc_project.Sensor.Value"
-        };
-        mapperMethod.append(interfaces);
-
-        auto mapperReply = bus.call(mapperMethod);
-
-        std::vector<std::string> sensorPaths;
-        mapperReply.read(sensorPaths);
-
-        std::cout << "Found " << sensorPaths.size() << " sensors:\n";
-        for (size_t i = 0; i < std::min(sensorPaths.size(), size_t(5)); ++i)
+    std::cout << "=== Finding Sensors via Object Mapper ===\n";
+    std::string firstSensor;
+    try
+    {
+        // Read in place: the paths are views into the reply, valid while
+        // `paths` lives (reply_view.hpp)
+        auto paths = reply_view::decodePaths(sensors.get());
+        std::cout << "Found " << paths->size() << " sensors:\n";
+        for (size_t i = 0; i < std::min(paths->size(), size_t(5)); ++i)
         {
-            std::cout << "  " << sensorPaths[i] << "\n";
+            std::cout << "  " << (*paths)[i] << "\n";
         }
-        if (sensorPaths.size() > 5)
+        if (paths->size() > 5)
         {
-            std::cout << "  ... and " << (sensorPaths.size() - 5) << " more\n";
+            std::cout << "  ... and " << (paths->size() - 5) << " more\n";
         }
         std::cout << "\n";
-
-        // ========================================
-        // Example 4: Read sensor value
-        // ========================================
-        if (!sensorPaths.empty())
+        if (!paths->empty())
         {
-            std::cout << "=== Reading First Sensor Value ===\n";
-
-            // First, find the service that owns this object
-            auto getServiceMethod = bus.new_method_call(
-                "xyz.openbmc_project.ObjectMapper",
-                "/xyz/openbmc_project/object_mapper",
-                "xyz.openbmc_project.ObjectMapper",
-                "GetObject"
-            );
-
-            getServiceMethod.append(sensorPaths[0]);
-            std::vector<std::string> empty;
-            getServiceMethod.append(empty);
-
-            auto serviceReply = bus.call(getServiceMethod);
+            firstSensor = paths->front();
+        }
+    }
+    catch (...)
+    {
+        printError(std::current_exception());
+        ++failures;
+    }
 
-            std::map<std::string, std::vector<std::string>> serviceMap;
-            serviceReply.read(serviceMap);
+    // ========================================
+    // Example 4: Read sensor value
+    // ========================================
+    if (!firstSensor.empty())
+    {
+        std::cout << "=== Reading First Sensor Value ===\n";
+        try
+        {
+            // First, find the service that owns this object. Code that
+            // does this repeatedly should cache it (mapper_cache.hpp).
+            auto serviceMap = co_await client.call<
+                std::map<std::string, std::vector<std::string>>>(
+                options, mapperService, mapperPath, mapperInterface,
+                "GetObject", firstSensor, std::vector<std::string>{});
 
             if (!serviceMap.empty())
             {
-                std::string service = serviceMap.begin()->first;
-
-                auto sensorMethod = bus.new_method_call(
-                    service.c_str(),
-                    sensorPaths[0].c_str(),
-                    "org.freedesktop.DBus.Properties",
-                    "Get"
-                );
+                auto value = co_await client.getProperty<double>(
+                    options, serviceMap.begin()->first, firstSensor,
+                    "xyz.openbmc_project.Sensor.Value", "Value");
 
-                sensorMethod.append("xyz.openbmc_project.Sensor.Value",
-                                   "Value");
+                std::cout << "Sensor: " << firstSensor << "\n";
+                std::cout << "Value: " << value << "\n";
+            }
+        }
+        catch (...)
+        {
+            printError(std::current_exception());
+            ++failures;
+        }
+    }
 
-                auto sensorReply = bus.call(sensorMethod);
+    std::cout << "\nExamples 1-3 took " << fanOut << " ms together, "
+              << millisecondsSince(start) << " ms in all\n";
+    co_return failures;
+}
 
-                std::variant<double> sensorValue;
-                sensorReply.read(sensorValue);
+void printUsage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [--timeout=MS] [--deadline=MS]\n"
+              << "  --timeout=MS        deadline per call, default 2000\n"
+              << "  --deadline=MS       for the whole run, default 5000\n";
+}
 
-                std::cout << "Sensor: " << sensorPaths[0] << "\n";
-                std::cout << "Value: " << std::get<double>(sensorValue) << "\n";
+int main(int argc, char* argv[])
+{
+    auto timeout = std::chrono::milliseconds(2000);
+    auto deadline = std::chrono::milliseconds(5000);
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        try
+        {
+            if (arg.starts_with("--timeout="))
+            {
+                timeout = std::chrono::milliseconds(std::stoi(arg.substr(10)));
             }
+            else if (arg.starts_with("--deadline="))
+            {
+                deadline = std::chrono::milliseconds(std::stoi(arg.substr(11)));
+            }
+            else
+            {
+                std::cerr << "Unknown option: " << arg << "\n";
+                return 1;
+            }
+        }
+        catch (const std::logic_error&) // from std::stoi
+        {
+            std::cerr << "Invalid value: " << arg << "\n";
+            printUsage(argv[0]);
+            return 1;
         }
+    }
+
+    try
+    {
+        // Connect to system bus
+        boost::asio::io_context io;
+        auto conn = std::make_shared<sdbusplus::asio::connection>(io);
+        std::cout << "Connected to D-Bus system bus\n\n";
+
+        AsyncClient client(conn);
 
-        std::cout << "\nD-Bus client example completed successfully!\n";
+        // Calls still pending when the run's deadline passes are cancelled
+        Cancellation cancellation;
+        boost::asio::steady_timer expiry(io, deadline);
+        expiry.async_wait([&](const boost::system::error_code& ec) {
+            if (!ec)
+            {
+                std::cerr << "Deadline passed, cancelling\n";
+                cancellation.cancel();
+            }
+        });
+
+        int status = 1;
+        boost::asio::co_spawn(
+            io, run(client, {timeout, &cancellation}),
+            [&](std::exception_ptr error, int failures) {
+                if (error)
+                {
+                    printError(error);
+                }
+                else if (failures == 0)
+                {
+                    std::cout << "\nD-Bus client example completed "
+                                 "successfully!\n";
+                    status = 0;
+                }
+                io.stop();
+            });
+        io.run();
+
+        return status;
     }
     catch (const sdbusplus::exception::exception& e)
     {
@@ -188,6 +305,4 @@ int main()
         std::cerr << "Description: " << e.description() << "\n";
         return 1;
     }
-
-    return 0;
 }
@@ -0,0 +1,350 @@
+/**
+ * Reply Decoding Benchmark
+ *
+ * Demonstrates how to:
+ * - Decode large replies without an allocation per string
+ *   (reply_view.hpp)
+ * - Count heap allocations by replacing the global operator new
+ *
+ * Builds two replies with --entries entries each: one shaped like
+ * GetSubTreePaths ("as" of sensor paths) and one like GetAll ("a{sv}"
+ * holding strings, integers, doubles and booleans). Each is decoded
+ * --rounds times in two ways:
+ *   - msg.read() into std::vector<std::string> and std::map<std::string,
+ *     std::variant<...>>, as dbus_client.cpp did;
+ *   - reply_view::decodePaths() and decodeProperties().
+ * For each it prints the operator new calls and bytes per decode, and the
+ * median time per decode, which includes freeing the result.
+ *
+ * The replies are built and sealed in this process and rewound before
+ * every round, so only decoding is timed, not a bus round trip. A bus
+ * connection is still opened, because sd-bus creates messages on one.
+ * Memory that sd-bus itself mallocs is not counted; reading a sealed
+ * message allocates none.
+ *
+ * Build with SDK:
+ *   $CXX -std=c++20 decode_bench.cpp -o decode_bench \
+ *       $(pkg-config --cflags --libs sdbusplus)
+ *
+ * Usage:
+ *   ./decode_bench [--entries=N] [--rounds=N]    # default 10000, 20
+ */
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/message.hpp>
+#include <systemd/sd-bus.h>
+#include "reply_view.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+// ========================================
+// Allocation counting
+// ========================================
+namespace
+{
+size_t allocations = 0;
+size_t allocatedBytes = 0;
+
+void* countedAlloc(std::size_t size, std::size_t align)
+{
+    ++allocations;
+    allocatedBytes += size;
+    // aligned_alloc wants a multiple of the alignment
+    void* p = align > alignof(std::max_align_t)
+                  ? std::aligned_alloc(align,
+                                       (size + align - 1) / align * align)
+                  : std::malloc(size);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+} // namespace
+
+void* operator new(std::size_t size)
+{
+    return countedAlloc(size, alignof(std::max_align_t));
+}
+
+void* operator new[](std::size_t size)
+{
+    return countedAlloc(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, std::align_val_t align)
+{
+    return countedAlloc(size, static_cast<std::size_t>(align));
+}
+
+void* operator new[](std::size_t size, std::align_val_t align)
+{
+    return countedAlloc(size, static_cast<std::size_t>(align));
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+// ========================================
+// Building the replies
+// ========================================
+using Clock = std::chrono::steady_clock;
+using PropertyValue =
+    std::variant<std::string, int64_t, uint64_t, double, bool>;
+using PropertyMap = std::map<std::string, PropertyValue>;
+
+sdbusplus::message_t newMessage(sdbusplus::bus_t& bus)
+{
+    return bus.new_method_call("xyz.openbmc_project.Example.Bench", "/",
+                               "xyz.openbmc_project.Example.Bench", "Decode");
+}
+
+// Seals `msg` so it can be read like a received reply
+void seal(sdbusplus::message_t& msg)
+{
+    int r = sd_bus_message_seal(msg.get(), 1, 0);
+    if (r < 0)
+    {
+        throw sdbusplus::exception::SdBusError(-r, "sd_bus_message_seal");
+    }
+}
+
+sdbusplus::message_t pathsReply(sdbusplus::bus_t& bus, size_t entries)
+{
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < entries; ++i)
+    {
+        paths.push_back("/xyz/openbmc_project/sensors/temperature/sensor_" +
+                        std::to_string(i));
+    }
+    auto msg = newMessage(bus);
+    msg.append(paths);
+    seal(msg);
+    return msg;
+}
+
+sdbusplus::message_t propertiesReply(sdbusplus::bus_t& bus, size_t entries)
+{
+    PropertyMap properties;
+    for (size_t i = 0; i < entries; ++i)
+    {
+        std::string name = "Property" + std::to_string(i);
+        switch (i % 5)
+        {
+            case 0:
+                properties.emplace(name, std::string("xyz.openbmc_project."
+                                                     "State.Host.HostState."
+                                                     "Running"));
+                break;
+            case 1:
+                properties.emplace(name, static_cast<int64_t>(i));
+                break;
+            case 2:
+                properties.emplace(name, static_cast<uint64_t>(i));
+                break;
+            case 3:
+                properties.emplace(name, i * 0.5);
+                break;
+            default:
+                properties.emplace(name, i % 2 == 0);
+                break;
+        }
+    }
+    auto msg = newMessage(bus);
+    msg.append(properties);
+    seal(msg);
+    return msg;
+}
+
+// ========================================
+// Measuring
+// ========================================
+struct Result
+{
+    double allocations = 0; // per decode
+    double bytes = 0;
+    double medianUs = 0;
+};
+
+// Runs `decode` on `msg`, rewound, `rounds` times. `decode` returns the
+// number of entries it found, so the work cannot be optimized away.
+template <typename Decode>
+Result measure(sdbusplus::message_t& msg, size_t rounds, size_t entries,
+               Decode decode)
+{
+    std::vector<double> times;
+    times.reserve(rounds);
+    size_t startAllocations = allocations;
+    size_t startBytes = allocatedBytes;
+    for (size_t i = 0; i < rounds; ++i)
+    {
+        sd_bus_message_rewind(msg.get(), 1);
+        auto start = Clock::now();
+        size_t found = decode(msg);
+        times.push_back(
+            std::chrono::duration<double, std::micro>(Clock::now() - start)
+                .count());
+        if (found != entries)
+        {
+            throw std::runtime_error("decoded " + std::to_string(found) +
+                                     " entries, expected " +
+                                     std::to_string(entries));
+        }
+    }
+    std::sort(times.begin(), times.end());
+
+    Result result;
+    result.allocations =
+        static_cast<double>(allocations - startAllocations) / rounds;
+    result.bytes = static_cast<double>(allocatedBytes - startBytes) / rounds;
+    result.medianUs = times[times.size() / 2];
+    return result;
+}
+
+void print(const std::string& name, const Result& result)
+{
+    std::cout << "  " << std::left << std::setw(34) << name << std::right
+              << std::setw(10) << std::fixed << std::setprecision(0)
+              << result.allocations << std::setw(12) << result.bytes
+              << std::setw(10) << std::setprecision(1) << result.medianUs
+              << "\n";
+}
+
+void printUsage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [--entries=N] [--rounds=N]\n"
+              << "  --entries=N         entries per reply, default 10000\n"
+              << "  --rounds=N          decodes of each reply, default 20\n";
+}
+
+int main(int argc, char* argv[])
+{
+    size_t entries = 10000;
+    size_t rounds = 20;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        try
+        {
+            if (arg.starts_with("--entries="))
+            {
+                entries = std::stoul(arg.substr(10));
+            }
+            else if (arg.starts_with("--rounds="))
+            {
+                rounds = std::max<size_t>(std::stoul(arg.substr(9)), 1);
+            }
+            else
+            {
+                std::cerr << "Unknown option: " << arg << "\n";
+                return 1;
+            }
+        }
+        catch (const std::logic_error&) // from std::stoul
+        {
+            std::cerr << "Invalid value: " << arg << "\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    try
+    {
+        auto bus = sdbusplus::bus::new_default();
+        auto paths = pathsReply(bus, entries);
+        auto properties = propertiesReply(bus, entries);
+
+        std::cout << "Decoding " << entries << "-entry replies, median of "
+                  << rounds << " rounds\n\n";
+        std::cout << "  " << std::left << std::setw(34) << "" << std::right
+                  << std::setw(10) << "allocs" << std::setw(12) << "bytes"
+                  << std::setw(10) << "us" << "\n";
+
+        std::cout << "GetSubTreePaths (as)\n";
+        print("std::vector<std::string>",
+              measure(paths, rounds, entries, [](sdbusplus::message_t& msg) {
+                  std::vector<std::string> decoded;
+                  msg.read(decoded);
+                  return decoded.size();
+              }));
+        print("reply_view::Paths",
+              measure(paths, rounds, entries, [](sdbusplus::message_t& msg) {
+                  auto decoded = reply_view::decodePaths(msg);
+                  return decoded->size();
+              }));
+
+        std::cout << "GetAll (a{sv})\n";
+        print("std::map<std::string, variant>",
+              measure(properties, rounds, entries,
+                      [](sdbusplus::message_t& msg) {
+                          PropertyMap decoded;
+                          msg.read(decoded);
+                          return decoded.size();
+                      }));
+        print("reply_view::Properties",
+              measure(properties, rounds, entries,
+                      [](sdbusplus::message_t& msg) {
+                          auto decoded = reply_view::decodeProperties(msg);
+                          return decoded->size();
+                      }));
+    }
+    catch (const sdbusplus::exception::exception& e)
+    {
+        std::cerr << "D-Bus error: " << e.what() << "\n";
+        return 1;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,517 @@
+/**
+ * ObjectMapper Resolution Cache
+ *
+ * Before reading a property, a client must learn which service owns the
+ * object, and asking the ObjectMapper's GetObject before every read doubles
+ * the round trips and makes the mapper a hotspot. MapperCache remembers
+ * the answers and forgets each one exactly when it may have changed:
+ *
+ *   MapperCache mapper(conn);
+ *   mapper.service(path, "xyz.openbmc_project.Sensor.Value",
+ *                  [](const boost::system::error_code& ec,
+ *                     const std::string& service) { ... });
+ *
+ * What is cached:
+ *   - GetObject(path) for every path asked about, with all of its
+ *     services and interfaces, so one entry answers any interface;
+ *   - "not found" answers (ResourceNotFound), so repeated lookups of a
+ *     path that does not exist do not reach the mapper either;
+ *   - GetSubTree(root, depth, interfaces) results, keyed by arguments.
+ * Concurrent misses for the same key share one call.
+ *
+ * What invalidates an entry:
+ *   - InterfacesAdded/Removed for a path: that path's entry, and every
+ *     subtree whose root is above it;
+ *   - NameOwnerChanged when a well-known name loses its owner: the
+ *     entries and subtrees that name the service;
+ *   - NameOwnerChanged when a well-known name gains an owner, and again
+ *     on the mapper's IntrospectionComplete for it: the negative entries
+ *     and subtrees, as the mapper will now find the new service's
+ *     objects. The mapper introspects the new service asynchronously, so
+ *     an answer cached between the two may predate it; a service that
+ *     creates its objects before requesting its name sends no
+ *     InterfacesAdded to correct it afterwards. Entries for paths already
+ *     resolved stay: a new service adding interfaces to an existing
+ *     object is announced with InterfacesAdded.
+ *   - Any owner change: every call still in flight, which the mapper may
+ *     have answered from its state before the change. Its callers get the
+ *     reply, but it is not cached.
+ * Unique names (":1.42") are ignored, as the mapper ignores them too.
+ *
+ * stats() counts hits, misses, negative hits, shared calls and
+ * invalidations, to confirm in the field that the cache is working.
+ * Everything runs on the connection's thread. Callbacks always run from
+ * its io_context, never inside object(), service() or subtree(), so a
+ * caller behaves the same whether or not the answer was cached.
+ */
+
+#pragma once
+
+#include <sdbusplus/asio/connection.hpp>
+#include <sdbusplus/bus/match.hpp>
+#include <sdbusplus/message.hpp>
+#include <systemd/sd-bus.h>
+#include <boost/asio/post.hpp>
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+class MapperCache
+{
+  public:
+    // GetObject: service -> interfaces
+    using ServiceMap = std::map<std::string, std::vector<std::string>>;
+    // GetSubTree: path -> service -> interfaces
+    using SubTree = std::map<std::string, ServiceMap>;
+
+    using ObjectCallback = std::function<void(
+        const boost::system::error_code&, const ServiceMap& services)>;
+    using ServiceCallback = std::function<void(
+        const boost::system::error_code&, const std::string& service)>;
+    using SubTreeCallback =
+        std::function<void(const boost::system::error_code&, const SubTree&)>;
+
+    struct Stats
+    {
+        size_t hits = 0;
+        size_t negativeHits = 0; // hits on "not found"
+        size_t misses = 0;       // calls sent to the mapper
+        size_t shared = 0;       // misses that joined a call in flight
+        size_t invalidations = 0;
+    };
+
+    explicit MapperCache(std::shared_ptr<sdbusplus::asio::connection> conn) :
+        conn_(std::move(conn))
+    {
+        namespace rules = sdbusplus::bus::match::rules;
+        // From every sender: the mapper follows the same signals
+        added_ = std::make_unique<sdbusplus::bus::match_t>(
+            *conn_, rules::interfacesAdded(),
+            [this](sdbusplus::message_t& msg) { objectChanged(msg); });
+        removed_ = std::make_unique<sdbusplus::bus::match_t>(
+            *conn_, rules::interfacesRemoved(),
+            [this](sdbusplus::message_t& msg) { objectChanged(msg); });
+        owners_ = std::make_unique<sdbusplus::bus::match_t>(
+            *conn_, rules::nameOwnerChanged(),
+            [this](sdbusplus::message_t& msg) { ownerChanged(msg); });
+        // Sent once the mapper has read a new service's objects
+        introspected_ = std::make_unique<sdbusplus::bus::match_t>(
+            *conn_,
+            rules::type::signal() + rules::sender(mapperService) +
+                rules::interface(mapperPrivateInterface) +
+                rules::member("IntrospectionComplete"),
+            [this](sdbusplus::message_t&) { serviceAppeared(); });
+    }
+
+    MapperCache(const MapperCache&) = delete;
+    MapperCache& operator=(const MapperCache&) = delete;
+
+    // The service providing `interface` on `path`. Fails with
+    // no_such_file_or_directory if there is none.
+    void service(const std::string& path, const std::string& interface,
+                 ServiceCallback callback)
+    {
+        object(path, [interface, callback = std::move(callback)](
+                         const boost::system::error_code& ec,
+                         const ServiceMap& services) {
+            if (ec)
+            {
+                callback(ec, "");
+                return;
+            }
+            for (const auto& [service, interfaces] : services)
+            {
+                if (std::ranges::find(interfaces, interface) !=
+                    interfaces.end())
+                {
+                    callback(ec, service);
+                    return;
+                }
+            }
+            callback(boost::system::errc::make_error_code(
+                         boost::system::errc::no_such_file_or_directory),
+                     "");
+        });
+    }
+
+    // Every service and interface on `path`, as GetObject returns them
+    void object(const std::string& path, ObjectCallback callback)
+    {
+        auto [it, inserted] = objects_.try_emplace(path);
+        auto& entry = it->second;
+        if (!inserted)
+        {
+            if (entry.ready)
+            {
+                bool found = !entry.services.empty();
+                ++(found ? stats_.hits : stats_.negativeHits);
+                // A copy: the entry may be dropped before this runs
+                boost::asio::post(
+                    conn_->get_io_context(),
+                    [callback = std::move(callback), found,
+                     services = entry.services]() {
+                        callback(found ? boost::system::error_code{}
+                                       : notFound(),
+                                 services);
+                    });
+            }
+            else
+            {
+                ++stats_.shared;
+                entry.waiters.push_back(std::move(callback));
+            }
+            return;
+        }
+
+        ++stats_.misses;
+        entry.waiters.push_back(std::move(callback));
+        auto msg = conn_->new_method_call(mapperService, mapperPath,
+                                          mapperInterface, "GetObject");
+        msg.append(path, std::vector<std::string>{});
+        uint64_t generation = entry.generation = ++generation_;
+        conn_->async_send(msg, [this, path, generation](
+                                   boost::system::error_code ec,
+                                   sdbusplus::message_t& reply) {
+            ServiceMap services;
+            bool cacheable = false;
+            if (!ec)
+            {
+                try
+                {
+                    reply.read(services);
+                    cacheable = true;
+                }
+                catch (const sdbusplus::exception::exception&)
+                {
+                    ec = boost::system::errc::make_error_code(
+                        boost::system::errc::bad_message);
+                }
+            }
+            else if (isNotFound(reply))
+            {
+                ec = notFound();
+                cacheable = true;
+            }
+            finishObject(path, generation, ec, services, cacheable);
+        });
+    }
+
+    // GetSubTree(root, depth, interfaces)
+    void subtree(const std::string& root, int32_t depth,
+                 std::vector<std::string> interfaces, SubTreeCallback callback)
+    {
+        std::ranges::sort(interfaces);
+        SubTreeKey key{root, depth, interfaces};
+        auto [it, inserted] = subtrees_.try_emplace(key);
+        auto& entry = it->second;
+        if (!inserted)
+        {
+            if (entry.ready)
+            {
+                ++stats_.hits;
+                boost::asio::post(conn_->get_io_context(),
+                                  [callback = std::move(callback),
+                                   tree = entry.tree]() {
+                                      callback({}, *tree);
+                                  });
+            }
+            else
+            {
+                ++stats_.shared;
+                entry.waiters.push_back(std::move(callback));
+            }
+            return;
+        }
+
+        ++stats_.misses;
+        entry.waiters.push_back(std::move(callback));
+        uint64_t generation = entry.generation = ++generation_;
+        conn_->async_method_call(
+            [this, key, generation](const boost::system::error_code& ec,
+                                    const SubTree& tree) {
+                finishSubTree(key, generation, ec, tree);
+            },
+            mapperService, mapperPath, mapperInterface, "GetSubTree", root,
+            depth, interfaces);
+    }
+
+    const Stats& stats() const
+    {
+        return stats_;
+    }
+
+  private:
+    static constexpr auto mapperService = "xyz.openbmc_project.ObjectMapper";
+    static constexpr auto mapperPath = "/xyz/openbmc_project/object_mapper";
+    static constexpr auto mapperInterface = "xyz.openbmc_project.ObjectMapper";
+    static constexpr auto mapperPrivateInterface =
+        "xyz.openbmc_project.ObjectMapper.Private";
+    static constexpr auto notFoundError =
+        "xyz.openbmc_project.Common.Error.ResourceNotFound";
+
+    // A cached answer, or a call in flight with the callers waiting on it.
+    // `generation` identifies the call, so the reply to a call whose entry
+    // was invalidated meanwhile is delivered but not cached.
+    struct ObjectEntry
+    {
+        bool ready = false;
+        ServiceMap services; // empty: not found
+        std::vector<ObjectCallback> waiters;
+        uint64_t generation = 0;
+    };
+
+    using SubTreeKey =
+        std::tuple<std::string, int32_t, std::vector<std::string>>;
+
+    struct SubTreeEntry
+    {
+        bool ready = false;
+        // Shared with posted hits, so a hit costs no copy of the tree
+        std::shared_ptr<const SubTree> tree;
+        std::vector<SubTreeCallback> waiters;
+        uint64_t generation = 0;
+    };
+
+    static boost::system::error_code notFound()
+    {
+        return boost::system::errc::make_error_code(
+            boost::system::errc::no_such_file_or_directory);
+    }
+
+    static bool isNotFound(sdbusplus::message_t& reply)
+    {
+        const sd_bus_error* error = sd_bus_message_get_error(reply.get());
+        return error != nullptr && error->name != nullptr &&
+               std::string_view(error->name) == notFoundError;
+    }
+
+    static bool isBelow(std::string_view path, std::string_view root)
+    {
+        return path == root || root == "/" ||
+               (path.starts_with(root) && path[root.size()] == '/');
+    }
+
+    void finishObject(const std::string& path, uint64_t generation,
+                      const boost::system::error_code& ec,
+                      const ServiceMap& services, bool cacheable)
+    {
+        auto it = objects_.find(path);
+        std::vector<ObjectCallback> waiters;
+        if (it != objects_.end() && it->second.generation == generation)
+        {
+            waiters = std::move(it->second.waiters);
+            if (cacheable)
+            {
+                it->second.ready = true;
+                it->second.services = services;
+                for (const auto& [service, interfaces] : services)
+                {
+                    pathsByService_[service].insert(path);
+                }
+            }
+            else
+            {
+                objects_.erase(it);
+            }
+        }
+        else
+        {
+            waiters = std::move(orphans_[generation]);
+            orphans_.erase(generation);
+        }
+        for (auto& waiter : waiters)
+        {
+            waiter(ec, services);
+        }
+    }
+
+    void finishSubTree(const SubTreeKey& key, uint64_t generation,
+                       const boost::system::error_code& ec,
+                       const SubTree& tree)
+    {
+        auto it = subtrees_.find(key);
+        std::vector<SubTreeCallback> waiters;
+        if (it != subtrees_.end() && it->second.generation == generation)
+        {
+            waiters = std::move(it->second.waiters);
+            if (!ec)
+            {
+                it->second.ready = true;
+                it->second.tree = std::make_shared<const SubTree>(tree);
+            }
+            else
+            {
+                subtrees_.erase(it);
+            }
+        }
+        else
+        {
+            waiters = std::move(subtreeOrphans_[generation]);
+            subtreeOrphans_.erase(generation);
+        }
+        for (auto& waiter : waiters)
+        {
+            waiter(ec, tree);
+        }
+    }
+
+    // Drops an object entry; callers still waiting get the reply that
+    // is on its way, which is no longer cached
+    void dropObject(std::map<std::string, ObjectEntry>::iterator it)
+    {
+        ++stats_.invalidations;
+        auto& entry = it->second;
+        if (!entry.ready)
+        {
+            orphans_[entry.generation] = std::move(entry.waiters);
+        }
+        for (const auto& [service, interfaces] : entry.services)
+        {
+            pathsByService_[service].erase(it->first);
+        }
+        objects_.erase(it);
+    }
+
+    template <typename Predicate>
+    void dropSubTrees(Predicate matches)
+    {
+        for (auto it = subtrees_.begin(); it != subtrees_.end();)
+        {
+            if (!matches(it->first, it->second))
+            {
+                ++it;
+                continue;
+            }
+            ++stats_.invalidations;
+            if (!it->second.ready)
+            {
+                subtreeOrphans_[it->second.generation] =
+                    std::move(it->second.waiters);
+            }
+            it = subtrees_.erase(it);
+        }
+    }
+
+    // InterfacesAdded or InterfacesRemoved: the first argument is the path
+    void objectChanged(sdbusplus::message_t& msg)
+    {
+        sdbusplus::message::object_path object;
+        try
+        {
+            msg.read(object);
+        }
+        catch (const sdbusplus::exception::exception&)
+        {
+            return;
+        }
+        const std::string& path = object.str;
+
+        auto it = objects_.find(path);
+        if (it != objects_.end())
+        {
+            dropObject(it);
+        }
+        dropSubTrees([&path](const SubTreeKey& key, const SubTreeEntry&) {
+            return isBelow(path, std::get<0>(key));
+        });
+    }
+
+    // Drops the calls in flight, whose answers may be from before an
+    // owner change
+    void dropPending()
+    {
+        for (auto it = objects_.begin(); it != objects_.end();)
+        {
+            auto next = std::next(it);
+            if (!it->second.ready)
+            {
+                dropObject(it);
+            }
+            it = next;
+        }
+    }
+
+    // A service (may have) appeared: the mapper can now find objects it
+    // could not before
+    void serviceAppeared()
+    {
+        for (auto it = objects_.begin(); it != objects_.end();)
+        {
+            auto next = std::next(it);
+            if (!it->second.ready || it->second.services.empty())
+            {
+                dropObject(it);
+            }
+            it = next;
+        }
+        dropSubTrees(
+            [](const SubTreeKey&, const SubTreeEntry&) { return true; });
+    }
+
+    void ownerChanged(sdbusplus::message_t& msg)
+    {
+        std::string name;
+        std::string oldOwner;
+        std::string newOwner;
+        try
+        {
+            msg.read(name, oldOwner, newOwner);
+        }
+        catch (const sdbusplus::exception::exception&)
+        {
+            return;
+        }
+        if (name.starts_with(':'))
+        {
+            return;
+        }
+
+        if (!oldOwner.empty())
+        {
+            auto paths = std::move(pathsByService_[name]);
+            pathsByService_.erase(name);
+            for (const auto& path : paths)
+            {
+                auto it = objects_.find(path);
+                if (it != objects_.end())
+                {
+                    dropObject(it);
+                }
+            }
+            dropPending();
+            dropSubTrees(
+                [&name](const SubTreeKey&, const SubTreeEntry& entry) {
+                    return !entry.ready ||
+                           std::ranges::any_of(
+                               *entry.tree, [&name](const auto& node) {
+                                   return node.second.contains(name);
+                               });
+                });
+        }
+        if (!newOwner.empty())
+        {
+            serviceAppeared();
+        }
+    }
+
+    std::shared_ptr<sdbusplus::asio::connection> conn_;
+    std::map<std::string, ObjectEntry> objects_;
+    std::map<SubTreeKey, SubTreeEntry> subtrees_;
+    // Which cached paths name a service, for NameOwnerChanged
+    std::map<std::string, std::set<std::string>> pathsByService_;
+    // Waiters of calls whose entries were dropped, by call
+    std::map<uint64_t, std::vector<ObjectCallback>> orphans_;
+    std::map<uint64_t, std::vector<SubTreeCallback>> subtreeOrphans_;
+    uint64_t generation_ = 0;
+    Stats stats_;
+    std::unique_ptr<sdbusplus::bus::match_t> added_;
+    std::unique_ptr<sdbusplus::bus::match_t> removed_;
+    std::unique_ptr<sdbusplus::bus::match_t> owners_;
+    std::unique_ptr<sdbusplus::bus::match_t> introspected_;
+};
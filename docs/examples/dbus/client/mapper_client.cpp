@@ -0,0 +1,155 @@
+/**
+ * D-Bus Mapper Cache Example
+ *
+ * Demonstrates how to:
+ * - Resolve the service owning an object through the ObjectMapper once,
+ *   not before every read (mapper_cache.hpp)
+ * - Remember subtree queries and "not found" answers
+ * - Watch the cache's hit/miss/invalidation counters
+ *
+ * Each round lists the sensors with GetSubTree, resolves each sensor's
+ * service and reads its Value, as Example 4 of dbus_client.cpp does for
+ * one sensor. It also looks up a path that does not exist. After the
+ * first round every lookup is a hit, so the mapper sees no more calls
+ * until a sensor service restarts or objects come and go; the counters
+ * printed after each round show it.
+ *
+ * Build with SDK:
+ *   $CXX -std=c++20 mapper_client.cpp -o mapper_client \
+ *       $(pkg-config --cflags --libs sdbusplus)
+ *
+ * Usage (on a BMC, or anywhere with an ObjectMapper):
+ *   ./mapper_client [--rounds=N]    # default 5, one per second
+ */
+
+#include <sdbusplus/asio/connection.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include "mapper_cache.hpp"
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+constexpr auto sensorRoot = "/xyz/openbmc_project/sensors";
+constexpr auto valueInterface = "xyz.openbmc_project.Sensor.Value";
+constexpr auto missingPath = "/xyz/openbmc_project/sensors/no_such_sensor";
+
+void printUsage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [--rounds=N]\n"
+              << "  --rounds=N          rounds, one per second, default 5\n";
+}
+
+int main(int argc, char* argv[])
+{
+    int rounds = 5;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        try
+        {
+            if (arg.starts_with("--rounds="))
+            {
+                rounds = std::stoi(arg.substr(9));
+            }
+            else
+            {
+                std::cerr << "Unknown option: " << arg << "\n";
+                return 1;
+            }
+        }
+        catch (const std::logic_error&) // from std::stoi
+        {
+            std::cerr << "Invalid value: " << arg << "\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    boost::asio::io_context io;
+    auto conn = std::make_shared<sdbusplus::asio::connection>(io);
+    MapperCache mapper(conn);
+
+    int round = 0;
+    size_t reads = 0;
+    boost::asio::steady_timer timer(io);
+    std::function<void()> next;
+
+    auto printStats = [&]() {
+        const auto& stats = mapper.stats();
+        std::cout << "Round " << round << ": " << reads << " values read;"
+                  << " hits " << stats.hits << ", negative hits "
+                  << stats.negativeHits << ", misses " << stats.misses
+                  << ", shared " << stats.shared << ", invalidations "
+                  << stats.invalidations << "\n";
+    };
+
+    // ========================================
+    // One round: list, resolve, read
+    // ========================================
+    auto runRound = [&]() {
+        reads = 0;
+        mapper.subtree(
+            sensorRoot, 0, {valueInterface},
+            [&](const boost::system::error_code& ec,
+                const MapperCache::SubTree& tree) {
+                if (ec)
+                {
+                    std::cerr << "GetSubTree failed: " << ec.message()
+                              << "\n";
+                    return;
+                }
+                for (const auto& [path, services] : tree)
+                {
+                    // Resolved separately, as code reading one sensor would
+                    mapper.service(
+                        path, valueInterface,
+                        [&, path](const boost::system::error_code& ec,
+                                  const std::string& service) {
+                            if (ec)
+                            {
+                                return;
+                            }
+                            conn->async_method_call(
+                                [&](const boost::system::error_code& ec,
+                                    const std::variant<double>&) {
+                                    reads += !ec;
+                                },
+                                service, path,
+                                "org.freedesktop.DBus.Properties", "Get",
+                                valueInterface, "Value");
+                        });
+                }
+            });
+
+        // A miss the first time, then a negative hit
+        mapper.service(missingPath, valueInterface,
+                       [](const boost::system::error_code&,
+                          const std::string&) {});
+    };
+
+    next = [&]() {
+        if (round > 0)
+        {
+            printStats();
+        }
+        if (round++ == rounds)
+        {
+            io.stop();
+            return;
+        }
+        runRound();
+        timer.expires_after(std::chrono::seconds(1));
+        timer.async_wait([&](const boost::system::error_code&) { next(); });
+    };
+
+    next();
+    io.run();
+
+    return 0;
+}
@@ -0,0 +1,439 @@
+/**
+ * Signal-Maintained Property Cache
+ *
+ * Reading a property with Get costs a round trip through dbus-daemon every
+ * time, however rarely it changes. PropertyCache fetches the properties
+ * once and then keeps them current from the signals the service sends
+ * anyway, so a read is a local lookup and the only bus traffic left is the
+ * change notifications.
+ *
+ *   PropertyCache cache(conn);
+ *   cache.watchManaged("xyz.openbmc_project.Example.Server",
+ *                      "/xyz/openbmc_project/example");
+ *   auto counter = cache.property<int64_t>(service, path, iface, "Counter");
+ *   if (const int64_t* value = counter.get()) ...
+ *
+ * watchManaged() loads a service's objects below an ObjectManager with
+ * GetManagedObjects; watchObject() loads one interface with GetAll, for
+ * services without an ObjectManager. After that:
+ *   - PropertiesChanged updates values, and re-reads invalidated ones;
+ *   - InterfacesAdded and InterfacesRemoved add and clear interfaces;
+ *   - NameOwnerChanged clears the service when it exits and loads it
+ *     again when it comes back.
+ * Each service gets one set of matches, however many scopes are watched
+ * on it. Signals outside the watched scopes are ignored.
+ *
+ * property<T>() returns a view of one cache slot, which can be taken
+ * before the data arrives. get() is a pointer check and a variant type
+ * check, with no lookup and no allocation. Slots are cleared but never
+ * freed, so views stay valid for the life of the cache. Everything runs on
+ * the connection's thread.
+ */
+
+#pragma once
+
+#include <sdbusplus/asio/connection.hpp>
+#include <sdbusplus/bus/match.hpp>
+#include <sdbusplus/message.hpp>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <variant>
+#include <vector>
+
+class PropertyCache
+{
+  public:
+    // Property types the cache understands. sdbusplus skips a property of
+    // any other type while decoding and stores a default Value, so it
+    // reads as `false`
+    using Value = std::variant<bool, uint8_t, int16_t, uint16_t, int32_t,
+                               uint32_t, int64_t, uint64_t, double,
+                               std::string, sdbusplus::message::object_path,
+                               std::vector<std::string>>;
+
+    // Read-only view of one cached property
+    template <typename T>
+    class Property
+    {
+      public:
+        // The value, or nullptr while it is unknown or of another type.
+        // The pointer is valid until the next signal is handled.
+        const T* get() const
+        {
+            return *slot_ ? std::get_if<T>(&**slot_) : nullptr;
+        }
+
+        std::optional<T> value() const
+        {
+            const T* current = get();
+            return current ? std::optional<T>(*current) : std::nullopt;
+        }
+
+      private:
+        friend class PropertyCache;
+        explicit Property(const std::optional<Value>& slot) : slot_(&slot) {}
+
+        const std::optional<Value>* slot_;
+    };
+
+    struct Stats
+    {
+        size_t calls = 0;   // GetManagedObjects, GetAll and Get sent
+        size_t signals = 0; // signals applied
+        size_t failures = 0;
+    };
+
+    explicit PropertyCache(std::shared_ptr<sdbusplus::asio::connection> conn) :
+        conn_(std::move(conn))
+    {}
+
+    PropertyCache(const PropertyCache&) = delete;
+    PropertyCache& operator=(const PropertyCache&) = delete;
+
+    // Cache every object `service` has at or below `root`, which must
+    // be the path of its ObjectManager
+    void watchManaged(const std::string& service, const std::string& root)
+    {
+        auto& entry = subscribe(service);
+        entry.scopes.push_back({root, ""});
+        load(entry, entry.scopes.back());
+    }
+
+    // Cache `interface` of the object at `path`
+    void watchObject(const std::string& service, const std::string& path,
+                     const std::string& interface)
+    {
+        auto& entry = subscribe(service);
+        entry.scopes.push_back({path, interface});
+        load(entry, entry.scopes.back());
+    }
+
+    template <typename T>
+    Property<T> property(const std::string& service, const std::string& path,
+                         const std::string& interface, const std::string& name)
+    {
+        return Property<T>(slot(subscribe(service), path, interface, name));
+    }
+
+    const Stats& stats() const
+    {
+        return stats_;
+    }
+
+  private:
+    using PropertyMap = std::map<std::string, Value>;
+    using InterfaceMap = std::map<std::string, PropertyMap>;
+    using ManagedObjects =
+        std::map<sdbusplus::message::object_path, InterfaceMap>;
+
+    // Map nodes never move, so views can point into them
+    using Slots = std::map<std::string, std::optional<Value>, std::less<>>;
+    using Interfaces = std::map<std::string, Slots, std::less<>>;
+    using Objects = std::map<std::string, Interfaces, std::less<>>;
+
+    struct Scope
+    {
+        std::string path;
+        std::string interface; // empty: the subtree of an ObjectManager
+    };
+
+    struct Service
+    {
+        std::string name;
+        Objects objects;
+        std::vector<Scope> scopes;
+        std::vector<std::unique_ptr<sdbusplus::bus::match_t>> matches;
+    };
+
+    // The service's entry, with its matches installed on first use
+    Service& subscribe(const std::string& name)
+    {
+        auto it = services_.find(name);
+        if (it != services_.end())
+        {
+            return *it->second;
+        }
+
+        auto& entry =
+            *services_.emplace(name, std::make_unique<Service>()).first->second;
+        entry.name = name;
+
+        namespace rules = sdbusplus::bus::match::rules;
+        auto watch = [this, &entry](const std::string& rule,
+                                    void (PropertyCache::*handler)(
+                                        Service&, sdbusplus::message_t&)) {
+            entry.matches.push_back(std::make_unique<sdbusplus::bus::match_t>(
+                *conn_, rule,
+                [this, &entry, handler](sdbusplus::message_t& msg) {
+                    (this->*handler)(entry, msg);
+                }));
+        };
+        // Matched by the well-known name, which dbus-daemon resolves to
+        // the current owner
+        watch(rules::type::signal() + rules::sender(name) +
+                  rules::interface("org.freedesktop.DBus.Properties") +
+                  rules::member("PropertiesChanged"),
+              &PropertyCache::propertiesChanged);
+        watch(rules::interfacesAdded() + rules::sender(name),
+              &PropertyCache::interfacesAdded);
+        watch(rules::interfacesRemoved() + rules::sender(name),
+              &PropertyCache::interfacesRemoved);
+        watch(rules::nameOwnerChanged(name), &PropertyCache::ownerChanged);
+        return entry;
+    }
+
+    std::optional<Value>& slot(Service& entry, std::string_view path,
+                               std::string_view interface,
+                               std::string_view name)
+    {
+        auto object = entry.objects.find(path);
+        if (object == entry.objects.end())
+        {
+            object = entry.objects.emplace(std::string(path), Interfaces{})
+                         .first;
+        }
+        auto iface = object->second.find(interface);
+        if (iface == object->second.end())
+        {
+            iface = object->second.emplace(std::string(interface), Slots{})
+                        .first;
+        }
+        auto property = iface->second.find(name);
+        if (property == iface->second.end())
+        {
+            property =
+                iface->second.emplace(std::string(name), std::nullopt).first;
+        }
+        return property->second;
+    }
+
+    static bool inScope(const Service& entry, std::string_view path,
+                        std::string_view interface)
+    {
+        for (const auto& scope : entry.scopes)
+        {
+            if (!scope.interface.empty())
+            {
+                if (path == scope.path && interface == scope.interface)
+                {
+                    return true;
+                }
+            }
+            else if (path == scope.path || scope.path == "/" ||
+                     (path.starts_with(scope.path) &&
+                      path[scope.path.size()] == '/'))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void store(Service& entry, const std::string& path,
+               const std::string& interface, PropertyMap& properties)
+    {
+        for (auto& [name, value] : properties)
+        {
+            slot(entry, path, interface, name) = std::move(value);
+        }
+    }
+
+    void clear(Service& entry, std::string_view path,
+               std::string_view interface)
+    {
+        auto object = entry.objects.find(path);
+        if (object == entry.objects.end())
+        {
+            return;
+        }
+        auto iface = object->second.find(interface);
+        if (iface != object->second.end())
+        {
+            for (auto& [name, value] : iface->second)
+            {
+                value.reset();
+            }
+        }
+    }
+
+    void load(Service& entry, const Scope& scope)
+    {
+        ++stats_.calls;
+        if (scope.interface.empty())
+        {
+            conn_->async_method_call(
+                [this, &entry](const boost::system::error_code& ec,
+                               ManagedObjects& objects) {
+                    if (ec)
+                    {
+                        ++stats_.failures;
+                        return;
+                    }
+                    for (auto& [path, interfaces] : objects)
+                    {
+                        for (auto& [interface, properties] : interfaces)
+                        {
+                            store(entry, path, interface, properties);
+                        }
+                    }
+                },
+                entry.name, scope.path, "org.freedesktop.DBus.ObjectManager",
+                "GetManagedObjects");
+        }
+        else
+        {
+            conn_->async_method_call(
+                [this, &entry, path = scope.path,
+                 interface = scope.interface](
+                    const boost::system::error_code& ec,
+                    PropertyMap& properties) {
+                    if (ec)
+                    {
+                        ++stats_.failures;
+                        return;
+                    }
+                    store(entry, path, interface, properties);
+                },
+                entry.name, scope.path, "org.freedesktop.DBus.Properties",
+                "GetAll", scope.interface);
+        }
+    }
+
+    // Invalidated properties are announced without their value
+    void reload(Service& entry, const std::string& path,
+                const std::string& interface, const std::string& name)
+    {
+        ++stats_.calls;
+        conn_->async_method_call(
+            [this, &entry, path, interface,
+             name](const boost::system::error_code& ec, Value& value) {
+                if (ec)
+                {
+                    ++stats_.failures;
+                    return;
+                }
+                slot(entry, path, interface, name) = std::move(value);
+            },
+            entry.name, path, "org.freedesktop.DBus.Properties", "Get",
+            interface, name);
+    }
+
+    void propertiesChanged(Service& entry, sdbusplus::message_t& msg)
+    {
+        std::string path = msg.get_path();
+        std::string interface;
+        PropertyMap changed;
+        std::vector<std::string> invalidated;
+        try
+        {
+            msg.read(interface, changed, invalidated);
+        }
+        catch (const sdbusplus::exception::exception&)
+        {
+            ++stats_.failures;
+            return;
+        }
+        if (!inScope(entry, path, interface))
+        {
+            return;
+        }
+        ++stats_.signals;
+        store(entry, path, interface, changed);
+        for (const auto& name : invalidated)
+        {
+            slot(entry, path, interface, name).reset();
+            reload(entry, path, interface, name);
+        }
+    }
+
+    void interfacesAdded(Service& entry, sdbusplus::message_t& msg)
+    {
+        sdbusplus::message::object_path path;
+        InterfaceMap interfaces;
+        try
+        {
+            msg.read(path, interfaces);
+        }
+        catch (const sdbusplus::exception::exception&)
+        {
+            ++stats_.failures;
+            return;
+        }
+        for (auto& [interface, properties] : interfaces)
+        {
+            if (inScope(entry, path.str, interface))
+            {
+                ++stats_.signals;
+                store(entry, path.str, interface, properties);
+            }
+        }
+    }
+
+    void interfacesRemoved(Service& entry, sdbusplus::message_t& msg)
+    {
+        sdbusplus::message::object_path path;
+        std::vector<std::string> interfaces;
+        try
+        {
+            msg.read(path, interfaces);
+        }
+        catch (const sdbusplus::exception::exception&)
+        {
+            ++stats_.failures;
+            return;
+        }
+        for (const auto& interface : interfaces)
+        {
+            if (inScope(entry, path.str, interface))
+            {
+                ++stats_.signals;
+                clear(entry, path.str, interface);
+            }
+        }
+    }
+
+    // A restarted service starts from scratch; so does the cache
+    void ownerChanged(Service& entry, sdbusplus::message_t& msg)
+    {
+        std::string name;
+        std::string oldOwner;
+        std::string newOwner;
+        try
+        {
+            msg.read(name, oldOwner, newOwner);
+        }
+        catch (const sdbusplus::exception::exception&)
+        {
+            ++stats_.failures;
+            return;
+        }
+        ++stats_.signals;
+        for (auto& [path, interfaces] : entry.objects)
+        {
+            for (auto& [interface, slots] : interfaces)
+            {
+                for (auto& [property, value] : slots)
+                {
+                    value.reset();
+                }
+            }
+        }
+        if (!newOwner.empty())
+        {
+            for (const auto& scope : entry.scopes)
+            {
+                load(entry, scope);
+            }
+        }
+    }
+
+    std::shared_ptr<sdbusplus::asio::connection> conn_;
+    std::map<std::string, std::unique_ptr<Service>, std::less<>> services_;
+    Stats stats_;
+};
@@ -0,0 +1,267 @@
+/**
+ * Zero-Copy Reply Decoding
+ *
+ * msg.read() into std::vector<std::string> or std::map<std::string,
+ * std::variant<...>> allocates once for each string and each map node,
+ * so decoding a 10,000-path GetSubTreePaths reply makes more than 10,000
+ * allocations, and they are all freed again moments later. The decoders
+ * here read strings as string_views into the reply's own buffer and keep
+ * the containers in one monotonic arena per reply. Decoding then takes a
+ * handful of allocations, however large the reply is.
+ *
+ *   auto paths = reply_view::decodePaths(reply);            // "as" or "ao"
+ *   for (std::string_view path : *paths) ...
+ *
+ *   auto properties = reply_view::decodeProperties(reply);  // "a{sv}"
+ *   if (auto state = properties->get<std::string_view>("CurrentHostState"))
+ *
+ * A Decoded<T> holds a reference to the message and owns the arena, so
+ * the views are valid for as long as it lives. They are not valid after
+ * that: copy a value into a std::string to keep it longer. Properties is
+ * a vector of (name, value) pairs sorted by name and searched by binary
+ * search, not a tree.
+ *
+ * Integer values are widened to int64_t or uint64_t, and strings, object
+ * paths and signatures all become string_views. Values of any other type
+ * (arrays, structs, variants, fds) are skipped and read as std::monostate.
+ * A malformed reply throws SdBusError, as msg.read() does.
+ */
+
+#pragma once
+
+#include <sdbusplus/exception.hpp>
+#include <sdbusplus/message.hpp>
+#include <systemd/sd-bus.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace reply_view
+{
+
+using Value = std::variant<std::monostate, bool, int64_t, uint64_t, double,
+                           std::string_view>;
+
+// First arena block; later ones grow geometrically
+constexpr size_t initialArena = 16 * 1024;
+
+// A decoded reply, valid while this object lives
+template <typename T>
+class Decoded
+{
+  public:
+    explicit Decoded(sdbusplus::message_t reply) :
+        reply_(std::move(reply)),
+        arena_(std::make_unique<std::pmr::monotonic_buffer_resource>(
+            initialArena)),
+        value_(arena_.get())
+    {}
+
+    T& operator*()
+    {
+        return value_;
+    }
+
+    const T& operator*() const
+    {
+        return value_;
+    }
+
+    T* operator->()
+    {
+        return &value_;
+    }
+
+    const T* operator->() const
+    {
+        return &value_;
+    }
+
+    // The reply the views point into
+    sdbusplus::message_t& message()
+    {
+        return reply_;
+    }
+
+  private:
+    // Declared in this order so the views go before what they point into
+    sdbusplus::message_t reply_;
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> arena_;
+    T value_;
+};
+
+using Paths = std::pmr::vector<std::string_view>;
+
+class Properties
+{
+  public:
+    using Entry = std::pair<std::string_view, Value>;
+
+    explicit Properties(std::pmr::memory_resource* arena) : entries_(arena) {}
+
+    const Value* find(std::string_view name) const
+    {
+        auto it = std::lower_bound(
+            entries_.begin(), entries_.end(), name,
+            [](const Entry& entry, std::string_view key) {
+                return entry.first < key;
+            });
+        return it != entries_.end() && it->first == name ? &it->second
+                                                         : nullptr;
+    }
+
+    // The value, or nullptr if it is missing or of another type
+    template <typename V>
+    const V* get(std::string_view name) const
+    {
+        const Value* value = find(name);
+        return value ? std::get_if<V>(value) : nullptr;
+    }
+
+    auto begin() const
+    {
+        return entries_.begin();
+    }
+
+    auto end() const
+    {
+        return entries_.end();
+    }
+
+    size_t size() const
+    {
+        return entries_.size();
+    }
+
+  private:
+    friend Decoded<Properties> decodeProperties(sdbusplus::message_t reply);
+
+    std::pmr::vector<Entry> entries_;
+};
+
+namespace detail
+{
+
+inline int check(int r)
+{
+    if (r < 0)
+    {
+        throw sdbusplus::exception::SdBusError(-r, "reply_view");
+    }
+    return r;
+}
+
+template <typename T>
+T readBasic(sd_bus_message* m, char type)
+{
+    T value{};
+    check(sd_bus_message_read_basic(m, type, &value));
+    return value;
+}
+
+// Reads the next value, of single complete type `signature`
+inline Value readValue(sd_bus_message* m, const char* signature)
+{
+    if (signature[0] == '\0' || signature[1] != '\0')
+    {
+        check(sd_bus_message_skip(m, signature));
+        return std::monostate{};
+    }
+    switch (signature[0])
+    {
+        case 'b':
+            return readBasic<int>(m, 'b') != 0;
+        case 'y':
+            return uint64_t{readBasic<uint8_t>(m, 'y')};
+        case 'n':
+            return int64_t{readBasic<int16_t>(m, 'n')};
+        case 'q':
+            return uint64_t{readBasic<uint16_t>(m, 'q')};
+        case 'i':
+            return int64_t{readBasic<int32_t>(m, 'i')};
+        case 'u':
+            return uint64_t{readBasic<uint32_t>(m, 'u')};
+        case 'x':
+            return readBasic<int64_t>(m, 'x');
+        case 't':
+            return readBasic<uint64_t>(m, 't');
+        case 'd':
+            return readBasic<double>(m, 'd');
+        case 's':
+        case 'o':
+        case 'g':
+            return std::string_view(readBasic<const char*>(m, signature[0]));
+        default:
+            check(sd_bus_message_skip(m, signature));
+            return std::monostate{};
+    }
+}
+
+} // namespace detail
+
+// Decodes an "as" or "ao" reply, such as GetSubTreePaths
+inline Decoded<Paths> decodePaths(sdbusplus::message_t reply)
+{
+    Decoded<Paths> paths(std::move(reply));
+    sd_bus_message* m = paths.message().get();
+
+    char type = 0;
+    const char* contents = nullptr;
+    detail::check(sd_bus_message_peek_type(m, &type, &contents));
+    std::string_view element = contents != nullptr ? contents : "";
+    if (type != 'a' || (element != "s" && element != "o"))
+    {
+        throw sdbusplus::exception::SdBusError(EBADMSG, "reply_view");
+    }
+    detail::check(sd_bus_message_enter_container(m, 'a', contents));
+    const char* path = nullptr;
+    while (detail::check(sd_bus_message_read_basic(m, contents[0], &path)) > 0)
+    {
+        paths->emplace_back(path);
+    }
+    detail::check(sd_bus_message_exit_container(m));
+    return paths;
+}
+
+// Decodes an "a{sv}" reply, such as GetAll
+inline Decoded<Properties> decodeProperties(sdbusplus::message_t reply)
+{
+    Decoded<Properties> properties(std::move(reply));
+    sd_bus_message* m = properties.message().get();
+    auto& entries = properties->entries_;
+
+    detail::check(sd_bus_message_enter_container(m, 'a', "{sv}"));
+    while (detail::check(sd_bus_message_enter_container(m, 'e', "sv")) > 0)
+    {
+        const char* name = nullptr;
+        detail::check(sd_bus_message_read_basic(m, 's', &name));
+        const char* signature = nullptr;
+        detail::check(sd_bus_message_peek_type(m, nullptr, &signature));
+        detail::check(sd_bus_message_enter_container(m, 'v', signature));
+        entries.emplace_back(name, detail::readValue(m, signature));
+        detail::check(sd_bus_message_exit_container(m));
+        detail::check(sd_bus_message_exit_container(m));
+    }
+    detail::check(sd_bus_message_exit_container(m));
+
+    // Services usually send them in order already
+    if (!std::is_sorted(entries.begin(), entries.end(),
+                        [](const auto& a, const auto& b) {
+                            return a.first < b.first;
+                        }))
+    {
+        std::sort(entries.begin(), entries.end(),
+                  [](const auto& a, const auto& b) {
+                      return a.first < b.first;
+                  });
+    }
+    return properties;
+}
+
+} // namespace reply_view
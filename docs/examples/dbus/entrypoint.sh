@@ -65,6 +65,100 @@ if [ "$1" = "demo" ]; then
     echo ""
     echo "Demo complete!"
 
+elif [ "$1" = "load" ]; then
+    shift
+    for COALESCE in 0 5; do
+        echo "=== dbus_server --coalesce-ms=$COALESCE ==="
+        ./builddir/dbus_server --quiet --coalesce-ms=$COALESCE > /dev/null &
+        SERVER_PID=$!
+        sleep 1
+        ./builddir/counter_load "$@"
+        kill "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+        echo ""
+    done
+
+elif [ "$1" = "threads" ]; then
+    shift
+    for THREADS in 0 1 2 4; do
+        echo "=== dbus_server --threads=$THREADS ==="
+        ./builddir/dbus_server --quiet --threads=$THREADS --objects=8 \
+            > /dev/null &
+        SERVER_PID=$!
+        sleep 1
+        ./builddir/counter_load --mix --objects=8 "$@"
+        kill "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+        echo ""
+    done
+
+elif [ "$1" = "scale" ]; then
+    # Startup time, RSS and GetManagedObjects time: eager vs lazy objects
+    printf "%-6s %7s %12s %10s %16s\n" mode objects "startup ms" "RSS KiB" \
+        "GetManaged ms"
+    for COUNT in 1000 10000 50000; do
+        for MODE in eager lazy; do
+            if [ "$MODE" = eager ]; then
+                ARGS="--objects=$COUNT"
+            else
+                ARGS="--lazy=$COUNT"
+            fi
+            ./builddir/dbus_server --quiet $ARGS > /tmp/server.log &
+            SERVER_PID=$!
+            until grep -q "^Startup:" /tmp/server.log; do sleep 0.1; done
+            STARTUP=$(sed -n 's/^Startup: .* in \([0-9.]*\) ms.*/\1/p' /tmp/server.log)
+            RSS=$(sed -n 's/^Startup: .*VmRSS \([0-9]*\) KiB/\1/p' /tmp/server.log)
+            BEGIN=$(date +%s%N)
+            busctl --system call $SERVICE /xyz/openbmc_project/example \
+                org.freedesktop.DBus.ObjectManager GetManagedObjects \
+                > /dev/null
+            END=$(date +%s%N)
+            printf "%-6s %7s %12.1f %10s %16s\n" $MODE $COUNT "$STARTUP" \
+                "$RSS" $(( (END - BEGIN) / 1000000 ))
+            kill "$SERVER_PID" 2>/dev/null || true
+            wait "$SERVER_PID" 2>/dev/null || true
+        done
+    done
+
+elif [ "$1" = "cache" ]; then
+    # Cached Counter follows Increment calls without any Get
+    ./builddir/dbus_server --quiet > /dev/null &
+    SERVER_PID=$!
+    sleep 1
+    ./builddir/cache_client --seconds=5 &
+    CLIENT_PID=$!
+    for _ in 1 2 3 4; do
+        sleep 1
+        dbus-send --system --dest=$SERVICE --print-reply \
+            $OBJECT $IFACE.Increment > /dev/null
+    done
+    wait "$CLIENT_PID"
+    kill "$SERVER_PID" 2>/dev/null || true
+
+elif [ "$1" = "snapshot" ]; then
+    # Reading N lazy counters: GetAll vs GetManagedObjects vs Snapshot
+    shift
+    for COUNT in 1000 5000 10000; do
+        echo "=== dbus_server --lazy=$COUNT ==="
+        ./builddir/dbus_server --quiet --lazy=$COUNT > /tmp/server.log &
+        SERVER_PID=$!
+        until grep -q "^Startup:" /tmp/server.log; do sleep 0.1; done
+        ./builddir/snapshot_client --bench "$@"
+        kill "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+        echo ""
+    done
+
+elif [ "$1" = "decode" ]; then
+    # msg.read() vs reply_view on 10k-entry replies, no server needed
+    shift
+    ./builddir/decode_bench "$@"
+
+elif [ "$1" = "bench" ]; then
+    # JSON Lines results; see bench/run_suite.sh for the options
+    shift
+    exec ./bench/run_suite.sh --builddir=./builddir "$@"
+
 elif [ "$1" = "shell" ]; then
     echo "D-Bus session ready. Start the server with:"
     echo "  ./builddir/dbus_server &"
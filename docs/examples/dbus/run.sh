@@ -3,6 +3,13 @@
 # Usage:
 #   ./run.sh          # run demo
 #   ./run.sh shell    # interactive shell
+#   ./run.sh load     # counter_load with signal coalescing off and at 5 ms
+#   ./run.sh threads  # mixed load against 0/1/2/4 Spin worker threads
+#   ./run.sh scale    # startup time and RSS, 1k/10k/50k eager vs lazy objects
+#   ./run.sh cache    # client-side property cache following Increment calls
+#   ./run.sh snapshot # read 1k/5k/10k values: GetAll, GetManagedObjects, memfd
+#   ./run.sh decode   # allocations and time decoding 10k-entry replies
+#   ./run.sh bench    # benchmark suite on a private bus, JSON Lines results
 set -e
 
-docker run --rm -it openbmc-dbus-examples "${1:-demo}"
+docker run --rm -it openbmc-dbus-examples "${@:-demo}"
@@ -0,0 +1,309 @@
+/**
+ * Counter Load Generator
+ *
+ * Drives dbus_server's Counter interface and reports operations per
+ * second and the PropertiesChanged signals it sent, in two phases of the
+ * same number of operations:
+ *   - Increment: one method call per operation;
+ *   - ApplyOps:  `--batch` operations per method call.
+ * Calls are pipelined, up to `--window` in flight. Signals are counted
+ * through a PropertiesChanged match; the ones still in flight when the
+ * last reply arrives are collected after the clock stops.
+ *
+ * With --mix it instead sends N calls spread over `--objects` counter
+ * objects: in every 20, 12 Gets, 4 Sets, 3 Increments and one Spin of
+ * `--spin` rounds. It reports calls/s and the Get latency percentiles,
+ * which show whether Gets wait behind Spins. Run it against
+ * `dbus_server --threads=0|1|2|4` to compare dispatch setups.
+ *
+ * Usage (start `dbus_server --quiet` first):
+ *   ./counter_load [--ops=N] [--batch=B] [--window=W]
+ *   ./counter_load --mix [--ops=N] [--objects=K] [--spin=R] [--window=W]
+ *
+ * Defaults: --ops=10000 --batch=100 --window=16 --objects=8
+ *           --spin=2000000
+ */
+
+#include <sdbusplus/asio/connection.hpp>
+#include <sdbusplus/bus/match.hpp>
+#include <boost/asio/io_context.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <variant>
+#include <vector>
+
+constexpr auto serviceName = "xyz.openbmc_project.Example.Server";
+constexpr auto objectPath = "/xyz/openbmc_project/example/server";
+constexpr auto interfaceName = "xyz.openbmc_project.Example.Counter";
+
+using Clock = std::chrono::steady_clock;
+
+// Sends one call and reports success to the callback it is given
+using Issue = std::function<void(std::function<void(bool)>)>;
+
+struct Phase
+{
+    size_t calls = 0;
+    size_t errors = 0;
+    double seconds = 0.0;
+};
+
+// Run `calls` calls made by `issue`, keeping up to `window` in flight
+Phase runPhase(boost::asio::io_context& io, size_t calls, size_t window,
+               const Issue& issue)
+{
+    Phase phase;
+    phase.calls = calls;
+    size_t sent = 0;
+    size_t done = 0;
+
+    std::function<void()> next = [&]() {
+        if (sent == calls)
+        {
+            return;
+        }
+        ++sent;
+        issue([&](bool ok) {
+            phase.errors += !ok;
+            if (++done == calls)
+            {
+                io.stop();
+                return;
+            }
+            next();
+        });
+    };
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < window && i < calls; ++i)
+    {
+        next();
+    }
+    io.restart();
+    io.run();
+    phase.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return phase;
+}
+
+std::string counterPath(size_t n)
+{
+    return n == 0 ? objectPath : objectPath + ("/" + std::to_string(n));
+}
+
+// Value at percentile `p` of `samples` (sorted in place)
+double percentile(std::vector<double>& samples, double p)
+{
+    if (samples.empty())
+    {
+        return 0.0;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto rank = static_cast<size_t>(p / 100.0 * (samples.size() - 1));
+    return samples[rank];
+}
+
+// Mixed Get/Set/Increment/Spin load over `objects` counters
+int runMix(boost::asio::io_context& io,
+           std::shared_ptr<sdbusplus::asio::connection>& conn, size_t calls,
+           size_t window, size_t objects, uint64_t spin)
+{
+    constexpr auto propertiesInterface = "org.freedesktop.DBus.Properties";
+    std::vector<double> getMicros;
+    getMicros.reserve(calls);
+    size_t spins = 0;
+    size_t index = 0;
+
+    auto issue = [&](std::function<void(bool)> done) {
+        size_t slot = index % 20;
+        auto path = counterPath(index % objects);
+        ++index;
+
+        if (slot < 12)
+        {
+            auto sent = Clock::now();
+            conn->async_method_call(
+                [&getMicros, sent, done](const boost::system::error_code& ec,
+                                         const std::variant<int64_t>&) {
+                    getMicros.push_back(
+                        std::chrono::duration<double, std::micro>(
+                            Clock::now() - sent)
+                            .count());
+                    done(!ec);
+                },
+                serviceName, path, propertiesInterface, "Get", interfaceName,
+                "Counter");
+        }
+        else if (slot < 16)
+        {
+            conn->async_method_call(
+                [done](const boost::system::error_code& ec) { done(!ec); },
+                serviceName, path, propertiesInterface, "Set", interfaceName,
+                "Counter", std::variant<int64_t>(static_cast<int64_t>(slot)));
+        }
+        else if (slot < 19)
+        {
+            conn->async_method_call(
+                [done](const boost::system::error_code& ec, int64_t) {
+                    done(!ec);
+                },
+                serviceName, path, interfaceName, "Increment");
+        }
+        else
+        {
+            ++spins;
+            conn->async_method_call(
+                [done](const boost::system::error_code& ec, int64_t) {
+                    done(!ec);
+                },
+                serviceName, path, interfaceName, "Spin", spin);
+        }
+    };
+
+    auto phase = runPhase(io, calls, window, issue);
+
+    std::printf("%8s %9s %9s %10s %10s %10s %6s %7s\n", "calls", "seconds",
+                "calls/s", "get p50us", "get p99us", "get max", "spins",
+                "errors");
+    double p50 = percentile(getMicros, 50);
+    double p99 = percentile(getMicros, 99);
+    double max = getMicros.empty() ? 0.0 : getMicros.back();
+    std::printf("%8zu %9.3f %9.0f %10.0f %10.0f %10.0f %6zu %7zu\n",
+                phase.calls, phase.seconds,
+                static_cast<double>(phase.calls) / phase.seconds, p50, p99,
+                max, spins, phase.errors);
+    return phase.errors == 0 ? 0 : 1;
+}
+
+// Let trailing signals arrive
+void drain(boost::asio::io_context& io)
+{
+    io.restart();
+    io.run_for(std::chrono::milliseconds(200));
+}
+
+void printUsage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [--mix] [OPTIONS]\n"
+              << "  --ops=N             operations, or calls with --mix\n"
+              << "  --batch=N           operations per ApplyOps\n"
+              << "  --window=N          calls in flight\n"
+              << "  --mix               mixed Get/Set/Increment/Spin load\n"
+              << "  --objects=N         counter objects for --mix\n"
+              << "  --spin=N            rounds per Spin for --mix\n";
+}
+
+int main(int argc, char* argv[])
+{
+    size_t ops = 10000;
+    size_t batchSize = 100;
+    size_t window = 16;
+    bool mix = false;
+    size_t objects = 8;
+    uint64_t spin = 2000000;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        try
+        {
+            if (arg == "--mix")
+            {
+                mix = true;
+            }
+            else if (arg.starts_with("--objects="))
+            {
+                objects = std::max<size_t>(std::stoul(arg.substr(10)), 1);
+            }
+            else if (arg.starts_with("--spin="))
+            {
+                spin = std::stoull(arg.substr(7));
+            }
+            else if (arg.starts_with("--ops="))
+            {
+                ops = std::max<size_t>(std::stoul(arg.substr(6)), 1);
+            }
+            else if (arg.starts_with("--batch="))
+            {
+                batchSize = std::max<size_t>(std::stoul(arg.substr(8)), 1);
+            }
+            else if (arg.starts_with("--window="))
+            {
+                window = std::max<size_t>(std::stoul(arg.substr(9)), 1);
+            }
+            else
+            {
+                std::cerr << "Unknown option: " << arg << "\n";
+                return 1;
+            }
+        }
+        catch (const std::logic_error&) // from std::stoul
+        {
+            std::cerr << "Invalid value: " << arg << "\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    boost::asio::io_context io;
+    auto conn = std::make_shared<sdbusplus::asio::connection>(io);
+    if (mix)
+    {
+        return runMix(io, conn, ops, window, objects, spin);
+    }
+
+    uint64_t signals = 0;
+    sdbusplus::bus::match_t match(
+        *conn,
+        sdbusplus::bus::match::rules::propertiesChanged(objectPath,
+                                                        interfaceName),
+        [&signals](sdbusplus::message_t&) { ++signals; });
+
+    auto call = [&conn](const char* method, auto&&... args) {
+        return [&conn, method, args...](std::function<void(bool)> done) {
+            conn->async_method_call(
+                [done](const boost::system::error_code& ec, int64_t) {
+                    done(!ec);
+                },
+                serviceName, objectPath, interfaceName, method, args...);
+        };
+    };
+
+    std::vector<std::tuple<std::string, int64_t>> batch(
+        batchSize, std::make_tuple(std::string("increment"), int64_t{0}));
+    size_t batches = (ops + batchSize - 1) / batchSize;
+
+    struct Run
+    {
+        const char* name;
+        size_t calls;
+        size_t opsPerCall;
+        Issue issue;
+    };
+    std::vector<Run> runs = {
+        {"Increment", ops, 1, call("Increment")},
+        {"ApplyOps", batches, batchSize, call("ApplyOps", batch)},
+    };
+
+    std::printf("%-10s %8s %8s %9s %11s %9s %7s\n", "phase", "calls", "ops",
+                "seconds", "ops/s", "signals", "errors");
+    for (const auto& run : runs)
+    {
+        drain(io);
+        signals = 0;
+        auto phase = runPhase(io, run.calls, window, run.issue);
+        drain(io);
+
+        size_t done = phase.calls * run.opsPerCall;
+        std::printf("%-10s %8zu %8zu %9.3f %11.0f %9llu %7zu\n", run.name,
+                    phase.calls, done, phase.seconds,
+                    static_cast<double>(done) / phase.seconds,
+                    static_cast<unsigned long long>(signals), phase.errors);
+    }
+    return 0;
+}
@@ -6,6 +6,17 @@
  * - Expose properties
  * - Handle property changes
  * - Emit signals
+ * - Batch many operations into one method call (ApplyOps)
+ * - Coalesce PropertiesChanged across calls (property_batch.hpp): changes
+ *   within --coalesce-ms of the first one go out as one signal
+ * - Keep long-running methods off the bus thread (offload.hpp): with
+ *   --threads=N, Spin runs on a thread pool, serialized per object by a
+ *   strand, while Gets and other calls keep being answered
+ * - Serve many objects: an ObjectManager at /xyz/openbmc_project/example
+ *   answers GetManagedObjects for all of them, and --lazy=N adds N
+ *   objects materialized on demand from a table (lazy_counters.hpp)
+ * - Return bulk data as a file descriptor: Snapshot on the ObjectManager
+ *   object returns every lazy counter in a sealed memfd (snapshot.hpp)
  *
  * Source Reference:
  *   - sdbusplus library: https://github.com/openbmc/sdbusplus
@@ -15,6 +26,19 @@
  * Build with SDK:
  *   $CXX -std=c++20 dbus_server.cpp -o dbus_server \
  *       $(pkg-config --cflags --libs sdbusplus)
+ *
+ * Usage:
+ *   ./dbus_server            # log every call
+ *   ./dbus_server --quiet    # no per-call logging (for counter_load)
+ *   ./dbus_server --threads=4 --objects=8
+ *                            # Spin on 4 pool threads; 8 counter objects
+ *   ./dbus_server --lazy=50000
+ *                            # plus 50,000 lazy objects under .../lazy/
+ *   ./dbus_server --coalesce-ms=0
+ *                            # one signal per handler; default 5 ms
+ *
+ * After registering its objects it prints the startup time and resident
+ * memory, for comparing --objects=N with --lazy=N.
  */
 
 #include <sdbusplus/bus.hpp>
@@ -22,124 +46,412 @@
 #include <sdbusplus/asio/connection.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 #include <boost/asio.hpp>
+#include "lazy_counters.hpp"
+#include "offload.hpp"
+#include "property_batch.hpp"
+#include "snapshot.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <tuple>
+#include <vector>
 
 // Service configuration
 constexpr auto serviceName = "xyz.openbmc_project.Example.Server";
 constexpr auto objectPath = "/xyz/openbmc_project/example/server";
 constexpr auto interfaceName = "xyz.openbmc_project.Example.Counter";
+constexpr auto managerPath = "/xyz/openbmc_project/example";
+constexpr auto snapshotInterface = "xyz.openbmc_project.Example.Snapshot";
+
+using Strand = boost::asio::strand<boost::asio::thread_pool::executor_type>;
 
-int main()
+/**
+ * One counter object on `path`. Every handler runs on the bus thread
+ * except the work inside Spin, which runs on `strand` when there is one.
+ * The counter is atomic because that work updates it while the bus thread
+ * may be answering a Get of it.
+ */
+class Counter
 {
-    // Create IO context for async operations
-    boost::asio::io_context io;
+  public:
+    Counter(sdbusplus::asio::object_server& server,
+            std::shared_ptr<sdbusplus::asio::connection> conn,
+            const std::string& path, std::optional<Strand> strand,
+            std::chrono::milliseconds coalesce, bool verbose) :
+        batch_(conn, path, interfaceName, coalesce),
+        strand_(std::move(strand)),
+        verbose_(verbose)
+    {
+        // Add interface to object
+        iface_ = server.add_interface(path, interfaceName);
 
-    // Connect to system bus
-    auto conn = std::make_shared<sdbusplus::asio::connection>(io);
+        // ========================================
+        // Property: Counter (read-write)
+        // ========================================
+        iface_->register_property(
+            "Counter", int64_t{0},
+            // Setter with validation
+            [this](const int64_t& newValue, int64_t& value) {
+                if (newValue < 0)
+                {
+                    std::cerr << "Rejected negative value: " << newValue
+                              << "\n";
+                    return false; // Reject the change
+                }
+                if (verbose_)
+                {
+                    std::cout << "Counter changed: " << counter_ << " -> "
+                              << newValue << "\n";
+                }
+                value = newValue;
+                counter_ = newValue;
+                return true; // Accept the change
+            },
+            // Getter
+            [this](const int64_t& /*value*/) { return counter_.load(); });
 
-    // Request well-known name
-    conn->request_name(serviceName);
-    std::cout << "Registered service: " << serviceName << "\n";
+        // ========================================
+        // Property: Name (read-only)
+        // ========================================
+        std::string name = "Example Server";
 
-    // Create object server
-    sdbusplus::asio::object_server server(conn);
+        iface_->register_property_r(
+            "Name", name, sdbusplus::vtable::property_::const_,
+            [name](const std::string&) { return name; });
 
-    // Add interface to object
-    auto iface = server.add_interface(objectPath, interfaceName);
+        // ========================================
+        // Property: Running (read-only)
+        // ========================================
+        iface_->register_property_r("Running", true,
+                                    sdbusplus::vtable::property_::const_,
+                                    [](const bool&) { return true; });
 
-    // ========================================
-    // Property: Counter (read-write)
-    // ========================================
-    int64_t counter = 0;
+        // ========================================
+        // Method: Increment
+        // ========================================
+        iface_->register_method("Increment", [this]() {
+            int64_t counter = ++counter_;
+            if (verbose_)
+            {
+                std::cout << "Increment called, counter = " << counter << "\n";
+            }
 
-    iface->register_property(
-        "Counter", counter,
-        // Setter with validation
-        [&counter](const int64_t& newValue, int64_t& value) {
-            if (newValue < 0)
+            // Emit PropertiesChanged signal once this call is handled
+            batch_.markDirty("Counter");
+
+            return counter;
+        });
+
+        // ========================================
+        // Method: Reset
+        // ========================================
+        iface_->register_method("Reset", [this]() {
+            int64_t oldValue = counter_.exchange(0);
+            if (verbose_)
             {
-                std::cerr << "Rejected negative value: " << newValue << "\n";
-                return false;  // Reject the change
+                std::cout << "Reset called, counter reset from " << oldValue
+                          << " to 0\n";
             }
-            std::cout << "Counter changed: " << value << " -> " << newValue << "\n";
-            value = newValue;
-            counter = newValue;
-            return true;  // Accept the change
-        },
-        // Getter
-        [&counter](const int64_t& /*value*/) {
+
+            batch_.markDirty("Counter");
+        });
+
+        // ========================================
+        // Method: Add (with parameter)
+        // ========================================
+        iface_->register_method("Add", [this](int64_t amount) {
+            int64_t counter = counter_ += amount;
+            if (verbose_)
+            {
+                std::cout << "Add(" << amount << ") called, counter = "
+                          << counter << "\n";
+            }
+
+            batch_.markDirty("Counter");
+
             return counter;
+        });
+
+        // ========================================
+        // Method: ApplyOps (batch)
+        // ========================================
+        // Applies ("increment"|"add"|"reset", argument) pairs in order, e.g.
+        //   busctl call ... ApplyOps 'a(sx)' 3 increment 0 add 5 reset 0
+        // The whole batch is rejected if any operation is unknown, and it
+        // sends a single PropertiesChanged with the final value.
+        using Op = std::tuple<std::string, int64_t>;
+        iface_->register_method("ApplyOps", [this](const std::vector<Op>& ops) {
+            for (const auto& [op, arg] : ops)
+            {
+                if (op != "increment" && op != "add" && op != "reset")
+                {
+                    throw sdbusplus::exception::SdBusError(
+                        EINVAL, ("ApplyOps: unknown operation " + op).c_str());
+                }
+            }
+
+            // Applied as one atomic update, so a concurrent Spin cannot
+            // land in the middle of the batch
+            int64_t before = counter_.load();
+            int64_t counter = 0;
+            do
+            {
+                counter = before;
+                for (const auto& [op, arg] : ops)
+                {
+                    if (op == "increment")
+                    {
+                        counter++;
+                    }
+                    else if (op == "add")
+                    {
+                        counter += arg;
+                    }
+                    else
+                    {
+                        counter = 0;
+                    }
+                }
+            } while (!counter_.compare_exchange_weak(before, counter));
+
+            if (verbose_)
+            {
+                std::cout << "ApplyOps(" << ops.size()
+                          << " ops) called, counter = " << counter << "\n";
+            }
+
+            batch_.markDirty("Counter");
+
+            return counter;
+        });
+
+        // ========================================
+        // Method: Spin (long-running)
+        // ========================================
+        // Burns `rounds` iterations of CPU work, then increments Counter.
+        // Taking a yield_context makes the handler a coroutine, so it can
+        // wait for offloaded work without blocking the bus thread.
+        iface_->register_method(
+            "Spin", [this](boost::asio::yield_context yield, uint64_t rounds) {
+                auto work = [this, rounds]() { return spin(rounds); };
+                int64_t counter =
+                    strand_ ? offload(*strand_, yield, work) : work();
+
+                // Back on the bus thread
+                batch_.markDirty("Counter");
+                return counter;
+            });
+
+        // Initialize the interface (make it visible on D-Bus)
+        iface_->initialize();
+    }
+
+    Counter(const Counter&) = delete;
+    Counter& operator=(const Counter&) = delete;
+
+  private:
+    // Runs on strand_: spinState_ needs no lock, as work for one object
+    // never runs on two threads at once
+    int64_t spin(uint64_t rounds)
+    {
+        for (uint64_t i = 0; i < rounds; ++i)
+        {
+            spinState_ = spinState_ * 6364136223846793005ULL +
+                         1442695040888963407ULL;
         }
-    );
+        return ++counter_;
+    }
 
-    // ========================================
-    // Property: Name (read-only)
-    // ========================================
-    std::string name = "Example Server";
+    std::shared_ptr<sdbusplus::asio::dbus_interface> iface_;
+    PropertyBatch batch_; // bus thread only
+    std::optional<Strand> strand_;
+    const bool verbose_;
 
-    iface->register_property_r(
-        "Name", name,
-        sdbusplus::vtable::property_::const_,
-        [&name](const std::string&) {
-            return name;
+    std::atomic<int64_t> counter_{0};
+    uint64_t spinState_ = 1;
+};
+
+// Resident set size of this process in KiB
+long residentKiB()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.starts_with("VmRSS:"))
+        {
+            return std::stol(line.substr(6));
         }
-    );
+    }
+    return 0;
+}
 
-    // ========================================
-    // Property: Running (read-only)
-    // ========================================
-    bool running = true;
+void printUsage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [OPTIONS]\n"
+              << "  --quiet             no per-call logging\n"
+              << "  --threads=N         pool threads for Spin, 0 = bus "
+                 "thread\n"
+              << "  --objects=N         counter objects\n"
+              << "  --lazy=N            lazy objects under .../lazy/\n"
+              << "  --coalesce-ms=MS    PropertiesChanged window, 0 = per "
+                 "call\n";
+}
 
-    iface->register_property_r(
-        "Running", running,
-        sdbusplus::vtable::property_::const_,
-        [&running](const bool&) {
-            return running;
+int main(int argc, char* argv[])
+{
+    auto start = std::chrono::steady_clock::now();
+    bool verbose = true;
+    size_t threads = 0;
+    size_t objects = 1;
+    size_t lazy = 0;
+    auto coalesce = std::chrono::milliseconds(5);
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        try
+        {
+            if (arg == "--quiet")
+            {
+                verbose = false;
+            }
+            else if (arg.starts_with("--threads="))
+            {
+                threads = std::stoul(arg.substr(10));
+            }
+            else if (arg.starts_with("--objects="))
+            {
+                objects = std::max<size_t>(std::stoul(arg.substr(10)), 1);
+            }
+            else if (arg.starts_with("--lazy="))
+            {
+                lazy = std::stoul(arg.substr(7));
+            }
+            else if (arg.starts_with("--coalesce-ms="))
+            {
+                coalesce =
+                    std::chrono::milliseconds(std::stoul(arg.substr(14)));
+            }
+            else
+            {
+                std::cerr << "Unknown option: " << arg << "\n";
+                return 1;
+            }
+        }
+        catch (const std::logic_error&) // from std::stoul
+        {
+            std::cerr << "Invalid value: " << arg << "\n";
+            printUsage(argv[0]);
+            return 1;
         }
-    );
+    }
 
-    // ========================================
-    // Method: Increment
-    // ========================================
-    iface->register_method("Increment", [&counter, &iface]() {
-        counter++;
-        std::cout << "Increment called, counter = " << counter << "\n";
+    // Create IO context for async operations
+    boost::asio::io_context io;
 
-        // Emit PropertiesChanged signal
-        iface->signal_property("Counter");
+    // Connect to system bus
+    auto conn = std::make_shared<sdbusplus::asio::connection>(io);
 
-        return counter;
-    });
+    // Request well-known name
+    conn->request_name(serviceName);
+    std::cout << "Registered service: " << serviceName << "\n";
 
-    // ========================================
-    // Method: Reset
-    // ========================================
-    iface->register_method("Reset", [&counter, &iface]() {
-        int64_t oldValue = counter;
-        counter = 0;
-        std::cout << "Reset called, counter reset from " << oldValue << " to 0\n";
+    // Create object server
+    sdbusplus::asio::object_server server(conn);
 
-        iface->signal_property("Counter");
-    });
+    // One GetManagedObjects returns every counter, eager or lazy
+    server.add_manager(managerPath);
 
-    // ========================================
-    // Method: Add (with parameter)
-    // ========================================
-    iface->register_method("Add", [&counter, &iface](int64_t amount) {
-        counter += amount;
-        std::cout << "Add(" << amount << ") called, counter = " << counter << "\n";
+    // Workers for long-running methods; the bus itself stays on this
+    // thread, as an sd-bus connection must not be used from two at once
+    std::optional<boost::asio::thread_pool> pool;
+    if (threads > 0)
+    {
+        pool.emplace(threads);
+    }
+
+    // The first counter is at objectPath, any others at objectPath/<n>
+    std::vector<std::unique_ptr<Counter>> counters;
+    for (size_t n = 0; n < objects; ++n)
+    {
+        std::string path = objectPath;
+        if (n > 0)
+        {
+            path += "/" + std::to_string(n);
+        }
+        std::optional<Strand> strand;
+        if (pool)
+        {
+            strand = boost::asio::make_strand(pool->get_executor());
+        }
+        counters.push_back(std::make_unique<Counter>(
+            server, conn, path, strand, coalesce, verbose));
+    }
 
-        iface->signal_property("Counter");
+    // Lazy objects: one table and two sd-bus registrations, however many
+    std::optional<LazyCounters> lazyCounters;
+    if (lazy > 0)
+    {
+        lazyCounters.emplace(*conn, std::string(objectPath) + "/lazy",
+                             interfaceName, lazy);
+    }
 
-        return counter;
+    // ========================================
+    // Method: Snapshot (bulk read)
+    // ========================================
+    // Returns a sealed memfd (type `h`) holding every lazy counter's value
+    // and last-change time. The file is rebuilt only after a counter has
+    // changed, so repeated calls send the same one; sd-bus sends a dup of
+    // the descriptor and snapshotFile keeps its own.
+    snapshot::SnapshotFile snapshotFile;
+    auto snapshotIface = server.add_interface(managerPath, snapshotInterface);
+    snapshotIface->register_method("Snapshot", [&]() {
+        try
+        {
+            int fd = lazyCounters
+                         ? snapshotFile.get(lazyCounters->entries(),
+                                            lazyCounters->generation())
+                         : snapshotFile.get({}, 0);
+            return sdbusplus::message::unix_fd(fd);
+        }
+        catch (const std::system_error& e)
+        {
+            throw sdbusplus::exception::SdBusError(e.code().value(),
+                                                   e.what());
+        }
     });
+    snapshotIface->initialize();
 
-    // Initialize the interface (make it visible on D-Bus)
-    iface->initialize();
+    auto startupMs = std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    std::cout << "Startup: " << objects << " eager + " << lazy
+              << " lazy objects in " << startupMs << " ms, VmRSS "
+              << residentKiB() << " KiB\n";
 
     std::cout << "Object path: " << objectPath << "\n";
+    if (objects > 1)
+    {
+        std::cout << "  and " << objects - 1 << " more under " << objectPath
+                  << "/\n";
+    }
     std::cout << "Interface: " << interfaceName << "\n";
+    if (lazyCounters)
+    {
+        std::cout << "Lazy objects: " << lazyCounters->path(0) << " .. "
+                  << lazyCounters->path(lazy - 1) << "\n";
+    }
+    std::cout << "ObjectManager: " << managerPath << "\n";
+    std::cout << "Snapshot: " << managerPath << " " << snapshotInterface
+              << "\n";
+    std::cout << "Spin workers: " << threads << "\n";
     std::cout << "\nServer running. Test with:\n";
     std::cout << "  busctl introspect " << serviceName << " " << objectPath << "\n";
     std::cout << "  busctl get-property " << serviceName << " " << objectPath
@@ -148,10 +460,29 @@ int main()
               << " " << interfaceName << " Increment\n";
     std::cout << "  busctl set-property " << serviceName << " " << objectPath
               << " " << interfaceName << " Counter x 42\n";
+    std::cout << "  busctl call " << serviceName << " " << objectPath << " "
+              << interfaceName << " ApplyOps 'a(sx)' 2 increment 0 add 5\n";
+    std::cout << "  busctl call " << serviceName << " " << objectPath << " "
+              << interfaceName << " Spin t 100000000\n";
+    std::cout << "  busctl call " << serviceName << " " << managerPath << " "
+              << snapshotInterface << " Snapshot\n";
     std::cout << "\nPress Ctrl+C to exit.\n";
 
+    // Ctrl+C and SIGTERM stop the loop, so the cleanup below runs
+    boost::asio::signal_set signals(io, SIGINT, SIGTERM);
+    signals.async_wait([&io](const boost::system::error_code&, int) {
+        io.stop();
+    });
+
     // Run the event loop
     io.run();
 
+    // `pool` outlives `counters`, and Spin work still queued on it uses its
+    // Counter, so let that work finish first
+    if (pool)
+    {
+        pool->join();
+    }
+
     return 0;
 }
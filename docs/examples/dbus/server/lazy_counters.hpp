@@ -0,0 +1,301 @@
+/**
+ * Lazily Materialized Counter Objects
+ *
+ * Every object registered through object_server::add_interface() and
+ * initialize() carries its own dbus_interface, vtable, property callbacks
+ * and sd-bus node, and its InterfacesAdded signal is sent at startup.
+ * That costs little for one object but a lot for tens of thousands.
+ *
+ * LazyCounters serves `count` counter objects at <prefix>/0 ..
+ * <prefix>/<count-1> from one std::vector<snapshot::Entry>, with two sd-bus
+ * registrations in total:
+ *   - a fallback vtable on <prefix>, whose find callback turns a path
+ *     into a pointer into the table when a call for it arrives;
+ *   - a node enumerator listing the paths, so introspection and
+ *     GetManagedObjects on an ObjectManager above <prefix> see them.
+ * An object costs 16 bytes, its value and the time it last changed, and
+ * startup time does not grow with the count. As the table already has the
+ * snapshot layout (snapshot.hpp), a snapshot of it is one memcpy.
+ *
+ * Each object has Counter (read-write, non-negative), Name and Running,
+ * plus Increment, Add and Reset; the batching and offloading of the eager
+ * objects in dbus_server.cpp are left out. Everything runs on the bus
+ * thread.
+ */
+
+#pragma once
+
+#include <sdbusplus/asio/connection.hpp>
+#include <sdbusplus/vtable.hpp>
+#include <systemd/sd-bus.h>
+#include "snapshot.hpp"
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+class LazyCounters
+{
+  public:
+    LazyCounters(sdbusplus::asio::connection& conn, std::string prefix,
+                 const char* interface, size_t count) :
+        prefix_(std::move(prefix)), interface_(interface),
+        counters_(count, snapshot::Entry{0, 0})
+    {
+        sd_bus_slot* slot = nullptr;
+        check(sd_bus_add_fallback_vtable(conn.get(), &slot, prefix_.c_str(),
+                                         interface_, vtable, &find, this),
+              "sd_bus_add_fallback_vtable");
+        vtableSlot_.reset(slot);
+
+        check(sd_bus_add_node_enumerator(conn.get(), &slot, prefix_.c_str(),
+                                         &enumerate, this),
+              "sd_bus_add_node_enumerator");
+        enumeratorSlot_.reset(slot);
+    }
+
+    LazyCounters(const LazyCounters&) = delete;
+    LazyCounters& operator=(const LazyCounters&) = delete;
+
+    size_t size() const
+    {
+        return counters_.size();
+    }
+
+    std::string path(size_t index) const
+    {
+        return prefix_ + "/" + std::to_string(index);
+    }
+
+    std::span<const snapshot::Entry> entries() const
+    {
+        return counters_;
+    }
+
+    // Advances on every change to any counter
+    uint64_t generation() const
+    {
+        return generation_;
+    }
+
+  private:
+    struct SlotDeleter
+    {
+        void operator()(sd_bus_slot* slot) const
+        {
+            sd_bus_slot_unref(slot);
+        }
+    };
+    using Slot = std::unique_ptr<sd_bus_slot, SlotDeleter>;
+
+    static void check(int r, const char* what)
+    {
+        if (r < 0)
+        {
+            throw std::system_error(-r, std::generic_category(), what);
+        }
+    }
+
+    // Callbacks get the entry find() returned as their userdata; the
+    // LazyCounters is the userdata of the vtable slot being dispatched
+    static LazyCounters& owner(sd_bus* bus)
+    {
+        return *static_cast<LazyCounters*>(
+            sd_bus_slot_get_userdata(sd_bus_get_current_slot(bus)));
+    }
+
+    // Records a change to `entry`
+    void touch(snapshot::Entry& entry)
+    {
+        entry.updatedUs = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now().time_since_epoch())
+                .count());
+        ++generation_;
+    }
+
+    // <prefix>/<n> -> &counters_[n]. Only the canonical spelling of n
+    // matches, so each object has exactly one path.
+    static int find(sd_bus*, const char* path, const char*, void* userdata,
+                    void** found, sd_bus_error*)
+    {
+        auto* self = static_cast<LazyCounters*>(userdata);
+        std::string_view rest(path);
+        if (!rest.starts_with(self->prefix_) ||
+            rest.size() <= self->prefix_.size() + 1 ||
+            rest[self->prefix_.size()] != '/')
+        {
+            return 0;
+        }
+        rest.remove_prefix(self->prefix_.size() + 1);
+        if (rest.size() > 1 && rest.front() == '0')
+        {
+            return 0;
+        }
+
+        size_t index = 0;
+        auto [end, ec] =
+            std::from_chars(rest.data(), rest.data() + rest.size(), index);
+        if (ec != std::errc{} || end != rest.data() + rest.size() ||
+            index >= self->counters_.size())
+        {
+            return 0;
+        }
+        *found = &self->counters_[index];
+        return 1;
+    }
+
+    // Child paths for introspection and GetManagedObjects; sd-bus frees
+    // the strv
+    static int enumerate(sd_bus*, const char*, void* userdata, char*** nodes,
+                         sd_bus_error*)
+    {
+        auto* self = static_cast<LazyCounters*>(userdata);
+        size_t count = self->counters_.size();
+        auto** list = static_cast<char**>(calloc(count + 1, sizeof(char*)));
+        if (list == nullptr)
+        {
+            return -ENOMEM;
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            list[i] = strdup(self->path(i).c_str());
+            if (list[i] == nullptr)
+            {
+                for (size_t j = 0; j < i; ++j)
+                {
+                    free(list[j]);
+                }
+                free(list);
+                return -ENOMEM;
+            }
+        }
+        *nodes = list;
+        return 0;
+    }
+
+    // Property and method callbacks get the pointer find() returned
+
+    static int getCounter(sd_bus*, const char*, const char*, const char*,
+                          sd_bus_message* reply, void* userdata, sd_bus_error*)
+    {
+        return sd_bus_message_append(
+            reply, "x", static_cast<snapshot::Entry*>(userdata)->value);
+    }
+
+    static int setCounter(sd_bus* bus, const char* path,
+                          const char* interface, const char*,
+                          sd_bus_message* value, void* userdata,
+                          sd_bus_error* error)
+    {
+        int64_t newValue = 0;
+        int r = sd_bus_message_read(value, "x", &newValue);
+        if (r < 0)
+        {
+            return r;
+        }
+        if (newValue < 0)
+        {
+            return sd_bus_error_set_const(error, SD_BUS_ERROR_INVALID_ARGS,
+                                          "Counter must not be negative");
+        }
+        auto& entry = *static_cast<snapshot::Entry*>(userdata);
+        entry.value = newValue;
+        owner(bus).touch(entry);
+        // sd-bus leaves PropertiesChanged to the implementation
+        sd_bus_emit_properties_changed(bus, path, interface, "Counter",
+                                       nullptr);
+        return 1;
+    }
+
+    static int getName(sd_bus*, const char*, const char*, const char*,
+                       sd_bus_message* reply, void*, sd_bus_error*)
+    {
+        return sd_bus_message_append(reply, "s", "Example Server");
+    }
+
+    static int getRunning(sd_bus*, const char*, const char*, const char*,
+                          sd_bus_message* reply, void*, sd_bus_error*)
+    {
+        return sd_bus_message_append(reply, "b", 1);
+    }
+
+    // Apply `op` to the counter, signal the change and reply with the
+    // new value (or nothing, for Reset)
+    template <typename Op>
+    static int update(sd_bus_message* call, void* userdata, Op op,
+                      bool reply = true)
+    {
+        auto& entry = *static_cast<snapshot::Entry*>(userdata);
+        int64_t& counter = entry.value;
+        int r = op(counter);
+        if (r < 0)
+        {
+            return r;
+        }
+        owner(sd_bus_message_get_bus(call)).touch(entry);
+        sd_bus_emit_properties_changed(sd_bus_message_get_bus(call),
+                                       sd_bus_message_get_path(call),
+                                       sd_bus_message_get_interface(call),
+                                       "Counter", nullptr);
+        return reply ? sd_bus_reply_method_return(call, "x", counter)
+                     : sd_bus_reply_method_return(call, "");
+    }
+
+    static int increment(sd_bus_message* call, void* userdata, sd_bus_error*)
+    {
+        return update(call, userdata, [](int64_t& counter) {
+            ++counter;
+            return 0;
+        });
+    }
+
+    static int add(sd_bus_message* call, void* userdata, sd_bus_error*)
+    {
+        return update(call, userdata, [call](int64_t& counter) {
+            int64_t amount = 0;
+            int r = sd_bus_message_read(call, "x", &amount);
+            counter += r < 0 ? 0 : amount;
+            return r;
+        });
+    }
+
+    static int reset(sd_bus_message* call, void* userdata, sd_bus_error*)
+    {
+        return update(
+            call, userdata,
+            [](int64_t& counter) {
+                counter = 0;
+                return 0;
+            },
+            false);
+    }
+
+    static constexpr sdbusplus::vtable::vtable_t vtable[] = {
+        sdbusplus::vtable::start(),
+        sdbusplus::vtable::property("Counter", "x", getCounter, setCounter,
+                                    sdbusplus::vtable::property_::emits_change),
+        sdbusplus::vtable::property("Name", "s", getName,
+                                    sdbusplus::vtable::property_::const_),
+        sdbusplus::vtable::property("Running", "b", getRunning,
+                                    sdbusplus::vtable::property_::const_),
+        sdbusplus::vtable::method("Increment", "", "x", increment),
+        sdbusplus::vtable::method("Add", "x", "x", add),
+        sdbusplus::vtable::method("Reset", "", "", reset),
+        sdbusplus::vtable::end(),
+    };
+
+    const std::string prefix_;
+    const char* interface_;
+    std::vector<snapshot::Entry> counters_;
+    uint64_t generation_ = 0;
+    Slot vtableSlot_;
+    Slot enumeratorSlot_;
+};
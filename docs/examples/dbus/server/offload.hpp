@@ -0,0 +1,63 @@
+/**
+ * Offloading Method Handlers
+ *
+ * An sd-bus connection is not thread-safe: it is read, dispatched and
+ * replied to on the one thread running its io_context. A handler that
+ * computes for a long time therefore holds up every other call on the
+ * connection, including plain property Gets on unrelated objects.
+ *
+ * offload() moves such work to another executor, normally a strand on a
+ * boost::asio::thread_pool, and suspends the calling method handler (a
+ * sdbusplus coroutine taking a yield_context) until it is done. The
+ * result is handed back on the handler's own executor, so the reply and
+ * anything else that touches the bus stay on the bus thread, while other
+ * calls are dispatched in the meantime.
+ *
+ *   iface->register_method("Spin",
+ *       [&](boost::asio::yield_context yield, uint64_t rounds) {
+ *           return offload(strand, yield, [rounds] { return work(rounds); });
+ *       });
+ *
+ * Using one strand per object serializes that object's offloaded work
+ * without a mutex, while work for different objects runs in parallel.
+ */
+
+#pragma once
+
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/spawn.hpp>
+#include <type_traits>
+#include <utility>
+
+// Run `work` on `executor` and return its result to the suspended caller
+template <typename Executor, typename Work>
+auto offload(const Executor& executor, boost::asio::yield_context yield,
+             Work work)
+{
+    using Result = std::invoke_result_t<Work&>;
+    static_assert(!std::is_void_v<Result>, "work must return a value");
+
+    return boost::asio::async_initiate<boost::asio::yield_context,
+                                       void(Result)>(
+        [executor](auto handler, Work work) {
+            // Keeps the caller's io_context running while nothing of ours
+            // is queued on it
+            auto home = boost::asio::make_work_guard(
+                boost::asio::get_associated_executor(handler));
+            boost::asio::post(executor, [handler = std::move(handler),
+                                         work = std::move(work),
+                                         home = std::move(home)]() mutable {
+                Result result = work();
+                boost::asio::post(home.get_executor(),
+                                  [handler = std::move(handler),
+                                   result = std::move(result)]() mutable {
+                                      std::move(handler)(std::move(result));
+                                  });
+                home.reset();
+            });
+        },
+        yield, std::move(work));
+}
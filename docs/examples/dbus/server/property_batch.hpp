@@ -0,0 +1,96 @@
+/**
+ * Coalesced PropertiesChanged
+ *
+ * signal_property() sends one PropertiesChanged per call, so a handler
+ * that changes a property N times sends N signals, each carrying a value
+ * that is already out of date. PropertyBatch instead records which
+ * properties of one interface are dirty, and the first change arms a
+ * timer for `window`. When it expires, one PropertiesChanged goes out
+ * naming every dirty property, with the values at that moment.
+ *
+ * Usage:
+ *   PropertyBatch batch(conn, objectPath, interfaceName,
+ *                       std::chrono::milliseconds(5));
+ *   counter += amount;
+ *   batch.markDirty("Counter"); // instead of iface->signal_property()
+ *
+ * Each D-Bus method call is dispatched in its own handler, so a window of
+ * 0 only merges changes made by one message (e.g. ApplyOps). A window of
+ * a few milliseconds also merges separate calls: 10,000 pipelined
+ * Increments send one signal per window instead of 10,000. Watchers see
+ * each change up to `window` later, and not every intermediate value.
+ */
+
+#pragma once
+
+#include <sdbusplus/asio/connection.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+class PropertyBatch
+{
+  public:
+    PropertyBatch(std::shared_ptr<sdbusplus::asio::connection> conn,
+                  std::string path, std::string interface,
+                  std::chrono::milliseconds window = {}) :
+        conn_(std::move(conn)), path_(std::move(path)),
+        interface_(std::move(interface)), window_(window),
+        timer_(conn_->get_io_context())
+    {}
+
+    PropertyBatch(const PropertyBatch&) = delete;
+    PropertyBatch& operator=(const PropertyBatch&) = delete;
+
+    void markDirty(const std::string& property)
+    {
+        if (std::find(dirty_.begin(), dirty_.end(), property) == dirty_.end())
+        {
+            dirty_.push_back(property);
+        }
+        if (!armed_)
+        {
+            armed_ = true;
+            timer_.expires_after(window_);
+            timer_.async_wait([this](const boost::system::error_code& ec) {
+                // Aborted only when the batch is destroyed
+                if (!ec)
+                {
+                    flush();
+                }
+            });
+        }
+    }
+
+    // Signals sent so far
+    uint64_t signals() const
+    {
+        return signals_;
+    }
+
+  private:
+    void flush()
+    {
+        armed_ = false;
+        if (dirty_.empty())
+        {
+            return;
+        }
+        conn_->emit_properties_changed(path_.c_str(), interface_.c_str(),
+                                       dirty_);
+        dirty_.clear();
+        ++signals_;
+    }
+
+    std::shared_ptr<sdbusplus::asio::connection> conn_;
+    const std::string path_;
+    const std::string interface_;
+    const std::chrono::milliseconds window_;
+    boost::asio::steady_timer timer_;
+    std::vector<std::string> dirty_; // a handful at most; linear search
+    bool armed_ = false;
+    uint64_t signals_ = 0;
+};
@@ -0,0 +1,246 @@
+/**
+ * Bulk Snapshots in a Sealed memfd
+ *
+ * Reading N values through GetAll or GetManagedObjects marshals every
+ * value as a variant inside dictionaries keyed by strings, and
+ * dbus-daemon copies and validates all of it on the way. A snapshot
+ * instead writes the values once into an anonymous memory file
+ * (memfd_create), seals it against any further change, and returns the
+ * file descriptor (D-Bus type `h`). Only the descriptor crosses the bus;
+ * the client maps the file and reads the entries in place.
+ *
+ * Layout, version 1 (native byte order, as both ends share the host):
+ *   Header  32 bytes: magic "SNAP", version, header and entry sizes,
+ *                     entry count, generation, time taken
+ *   Entry[] 16 bytes each: value, time of its last change
+ * A reader accepts only the version and sizes it was built for; adding or
+ * changing a field means a new version.
+ *
+ * Server:
+ *   SnapshotFile file;
+ *   int fd = file.get(entries, generation); // reused until generation moves
+ *   return sdbusplus::message::unix_fd(fd); // sd-bus sends a dup
+ *
+ * Client:
+ *   SnapshotView view(fd);                  // checks seals and header
+ *   for (const auto& entry : view.entries()) ...
+ *
+ * The client must not trust an unsealed file: the sender could shrink it
+ * while it is mapped, and the reader would fault on the missing pages.
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+namespace snapshot
+{
+
+constexpr uint32_t magic = 0x50414e53; // "SNAP" in little endian
+constexpr uint16_t version = 1;
+
+struct Header
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t entrySize;
+    uint32_t count;
+    uint64_t generation; // changes whenever any entry does
+    uint64_t takenUs;    // CLOCK_REALTIME, microseconds
+};
+
+struct Entry
+{
+    int64_t value;
+    uint64_t updatedUs; // CLOCK_REALTIME, microseconds
+};
+
+static_assert(std::is_trivially_copyable_v<Header> && sizeof(Header) == 32);
+static_assert(std::is_trivially_copyable_v<Entry> && sizeof(Entry) == 16);
+
+// Seals a reader requires: the size and contents can no longer change.
+// With F_SEAL_WRITE set, kernels before 6.7 refuse any MAP_SHARED mapping
+// of a descriptor opened read-write (EPERM), even a PROT_READ one, and the
+// descriptor received over D-Bus is still O_RDWR. SnapshotView therefore
+// maps it MAP_PRIVATE: since nothing can write the file, a read-only
+// private mapping shares the page cache pages and reads without a copy.
+constexpr int requiredSeals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE;
+
+inline void check(int r, const char* what)
+{
+    if (r < 0)
+    {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+}
+
+// Owns a file descriptor
+class UniqueFd
+{
+  public:
+    UniqueFd() = default;
+    explicit UniqueFd(int fd) : fd_(fd) {}
+    UniqueFd(UniqueFd&& other) noexcept : fd_(std::exchange(other.fd_, -1)) {}
+    UniqueFd& operator=(UniqueFd&& other) noexcept
+    {
+        std::swap(fd_, other.fd_);
+        return *this;
+    }
+    ~UniqueFd()
+    {
+        if (fd_ >= 0)
+        {
+            close(fd_);
+        }
+    }
+
+    int get() const
+    {
+        return fd_;
+    }
+
+  private:
+    int fd_ = -1;
+};
+
+// A new sealed memfd holding `entries`
+inline UniqueFd create(std::span<const Entry> entries, uint64_t generation,
+                       uint64_t takenUs)
+{
+    UniqueFd fd(memfd_create("snapshot", MFD_CLOEXEC | MFD_ALLOW_SEALING));
+    check(fd.get(), "memfd_create");
+
+    size_t size = sizeof(Header) + entries.size_bytes();
+    check(ftruncate(fd.get(), static_cast<off_t>(size)), "ftruncate");
+
+    // Written through a shared mapping, straight into the file's pages
+    void* map = mmap(nullptr, size, PROT_WRITE, MAP_SHARED, fd.get(), 0);
+    if (map == MAP_FAILED)
+    {
+        check(-1, "mmap");
+    }
+    Header header{magic,
+                  version,
+                  sizeof(Header),
+                  sizeof(Entry),
+                  static_cast<uint32_t>(entries.size()),
+                  generation,
+                  takenUs};
+    std::memcpy(map, &header, sizeof(header));
+    if (!entries.empty())
+    {
+        std::memcpy(static_cast<char*>(map) + sizeof(Header), entries.data(),
+                    entries.size_bytes());
+    }
+    // F_SEAL_WRITE is refused while a writable mapping exists
+    munmap(map, size);
+
+    check(fcntl(fd.get(), F_ADD_SEALS, requiredSeals | F_SEAL_SEAL),
+          "F_ADD_SEALS");
+    return fd;
+}
+
+// The server's current snapshot, rebuilt only when the data has changed
+class SnapshotFile
+{
+  public:
+    // Descriptor of a snapshot of `entries` at `generation`; it stays
+    // owned by this object, and callers that send it send a dup
+    int get(std::span<const Entry> entries, uint64_t generation)
+    {
+        if (fd_.get() < 0 || generation != generation_)
+        {
+            auto taken = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now().time_since_epoch());
+            fd_ = create(entries, generation,
+                         static_cast<uint64_t>(taken.count()));
+            generation_ = generation;
+        }
+        return fd_.get();
+    }
+
+  private:
+    UniqueFd fd_;
+    uint64_t generation_ = 0;
+};
+
+// A received snapshot, mapped read-only for as long as the view lives
+class SnapshotView
+{
+  public:
+    // Validates and maps `fd`, which the view does not take over
+    explicit SnapshotView(int fd)
+    {
+        int seals = fcntl(fd, F_GET_SEALS);
+        check(seals, "F_GET_SEALS");
+        if ((seals & requiredSeals) != requiredSeals)
+        {
+            throw std::runtime_error("snapshot: file is not sealed");
+        }
+
+        struct stat st{};
+        check(fstat(fd, &st), "fstat");
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ < sizeof(Header))
+        {
+            throw std::runtime_error("snapshot: file too small");
+        }
+
+        // MAP_PRIVATE: see requiredSeals
+        void* map = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            check(-1, "mmap");
+        }
+        map_ = map;
+
+        const auto& head = header();
+        if (head.magic != magic || head.version != version ||
+            head.headerSize != sizeof(Header) ||
+            head.entrySize != sizeof(Entry) ||
+            size_ != sizeof(Header) + size_t{head.count} * sizeof(Entry))
+        {
+            munmap(map_, size_);
+            throw std::runtime_error("snapshot: unsupported layout");
+        }
+    }
+
+    SnapshotView(const SnapshotView&) = delete;
+    SnapshotView& operator=(const SnapshotView&) = delete;
+
+    ~SnapshotView()
+    {
+        munmap(map_, size_);
+    }
+
+    const Header& header() const
+    {
+        return *static_cast<const Header*>(map_);
+    }
+
+    std::span<const Entry> entries() const
+    {
+        return {reinterpret_cast<const Entry*>(
+                    static_cast<const char*>(map_) + sizeof(Header)),
+                header().count};
+    }
+
+  private:
+    void* map_ = nullptr;
+    size_t size_ = 0;
+};
+
+} // namespace snapshot
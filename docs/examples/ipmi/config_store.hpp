@@ -0,0 +1,345 @@
+/**
+ * OEM Configuration Store
+ *
+ * Keeps the Set/Get Config values in a fixed array indexed by
+ * ConfigIndex. The array is backed by a small memory-mapped file, so the
+ * values survive an ipmid restart or a BMC reboot.
+ *
+ * The file holds two copies (slots) of the configuration. Each slot sits
+ * on its own page and carries a sequence number and a CRC-32. A commit
+ * writes the slot that does not hold the current copy, with the next
+ * sequence number, and msyncs that page. A crash part way through leaves
+ * the other slot untouched, and the torn one fails its CRC. Loading
+ * therefore always finds a whole configuration: the valid slot with the
+ * higher sequence number.
+ *
+ * Writes are write-behind. set() updates the array and, if no commit is
+ * pending, schedules one flushDelay later on ipmid's io_context. That
+ * commit stores everything set in the meantime, so a burst of Set Config
+ * commands costs one msync instead of one per command. A value set within
+ * flushDelay of a power loss can be lost even though the command was
+ * already acknowledged. A commit that fails is retried on the same timer,
+ * with the delay doubling up to maxRetryDelay, until one succeeds.
+ *
+ * get() is a plain array read, with no lock and no I/O. Everything runs
+ * on ipmid's main thread. Loading at startup maps two pages and checks two
+ * CRCs over a few dozen bytes.
+ *
+ * Some filesystems cannot map a file writably: static-flash OpenBMC
+ * layouts keep /var/lib on JFFS2, which only supports read-only mmap.
+ * There the store keeps the same two-slot layout but loads the slots with
+ * pread and commits with pwrite of the spare slot plus fdatasync. When the
+ * file is first created, its directory is fsynced too, so the file itself
+ * survives a power cut. Only if the file cannot be opened at all does the
+ * store log the error and keep working from memory.
+ */
+
+#pragma once
+
+#include "oem_handler.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <phosphor-logging/log.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+namespace myoem
+{
+
+class ConfigStore
+{
+  public:
+    // How long set() waits before committing, to gather a burst of writes
+    static constexpr auto flushDelay = std::chrono::milliseconds(100);
+    // Upper bound of the backoff between retries of a failed commit
+    static constexpr auto maxRetryDelay = std::chrono::seconds(10);
+
+    ConfigStore(boost::asio::io_context& io, const std::string& path) :
+        timer_(io), path_(path)
+    {
+        load();
+    }
+
+    ConfigStore(const ConfigStore&) = delete;
+    ConfigStore& operator=(const ConfigStore&) = delete;
+
+    ~ConfigStore()
+    {
+        if (flushPending_)
+        {
+            timer_.cancel();
+            commit();
+        }
+        if (map_ != nullptr)
+        {
+            munmap(map_, 2 * pageSize_);
+        }
+        if (fd_ >= 0)
+        {
+            close(fd_);
+        }
+    }
+
+    uint8_t get(ConfigIndex index) const
+    {
+        return values_[static_cast<size_t>(index)];
+    }
+
+    void set(ConfigIndex index, uint8_t value)
+    {
+        values_[static_cast<size_t>(index)] = value;
+        if (!flushPending_)
+        {
+            schedule(flushDelay);
+        }
+    }
+
+    // Writes the values to the spare slot and makes it the current one
+    void commit()
+    {
+        using namespace phosphor::logging;
+
+        flushPending_ = false;
+        if (fd_ < 0 || (hasSaved_ && saved_ == values_))
+        {
+            return;
+        }
+
+        // Built aside so the padding is zero and covered by the CRC
+        Slot next;
+        std::memset(&next, 0, sizeof(next));
+        next.magic = slotMagic;
+        next.version = slotVersion;
+        next.count = configCount;
+        next.sequence = sequence_ + 1;
+        std::memcpy(next.values.data(), values_.data(), values_.size());
+        next.crc = crc32(&next, offsetof(Slot, crc));
+
+        size_t spare = 1 - current_;
+        if (!writeSlot(spare, next))
+        {
+            // The current slot is still intact. Retry later, or get()
+            // keeps returning values that never reach the file.
+            log<level::ERR>("Failed to sync OEM config",
+                entry("PATH=%s", path_.c_str()),
+                entry("ERRNO=%d", errno),
+                entry("RETRY_MS=%lld",
+                      static_cast<long long>(retryDelay_.count())));
+            schedule(retryDelay_);
+            retryDelay_ = std::min<std::chrono::milliseconds>(
+                2 * retryDelay_, maxRetryDelay);
+            return;
+        }
+        retryDelay_ = flushDelay;
+        current_ = spare;
+        sequence_ = next.sequence;
+        saved_ = values_;
+        hasSaved_ = true;
+    }
+
+  private:
+    // Commits after delay; a later set() joins this commit
+    void schedule(std::chrono::milliseconds delay)
+    {
+        flushPending_ = true;
+        timer_.expires_after(delay);
+        timer_.async_wait([this](const boost::system::error_code& ec) {
+            if (!ec)
+            {
+                commit();
+            }
+        });
+    }
+
+    static constexpr uint32_t slotMagic = 0x434f594d; // "MYOC"
+    static constexpr uint16_t slotVersion = 1;
+    // Room for more indices later without changing the layout
+    static constexpr size_t slotCapacity = 64;
+
+    struct Slot
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t count; // values in use
+        uint64_t sequence;
+        std::array<uint8_t, slotCapacity> values;
+        uint32_t crc; // CRC-32 of everything before it
+    };
+    static_assert(configCount <= slotCapacity);
+    static_assert(sizeof(Slot) <= 4096, "a slot must fit in one page");
+
+    // CRC-32 (IEEE 802.3); the data is a few dozen bytes, so no table
+    static uint32_t crc32(const void* data, size_t size)
+    {
+        auto bytes = static_cast<const uint8_t*>(data);
+        uint32_t crc = 0xffffffff;
+        for (size_t i = 0; i < size; ++i)
+        {
+            crc ^= bytes[i];
+            for (int bit = 0; bit < 8; ++bit)
+            {
+                crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+            }
+        }
+        return ~crc;
+    }
+
+    static bool valid(const Slot& s)
+    {
+        return s.magic == slotMagic && s.version == slotVersion &&
+               s.count <= slotCapacity &&
+               s.crc == crc32(&s, offsetof(Slot, crc));
+    }
+
+    off_t offset(size_t index) const
+    {
+        return static_cast<off_t>(index * pageSize_);
+    }
+
+    bool readSlot(size_t index, Slot& s) const
+    {
+        if (map_ != nullptr)
+        {
+            std::memcpy(&s, map_ + offset(index), sizeof(s));
+            return true;
+        }
+        return pread(fd_, &s, sizeof(s), offset(index)) ==
+               static_cast<ssize_t>(sizeof(s));
+    }
+
+    // Writes a slot and waits until it is on flash
+    bool writeSlot(size_t index, const Slot& s)
+    {
+        if (map_ != nullptr)
+        {
+            std::memcpy(map_ + offset(index), &s, sizeof(s));
+            return msync(map_ + offset(index), pageSize_, MS_SYNC) == 0;
+        }
+        return pwrite(fd_, &s, sizeof(s), offset(index)) ==
+                   static_cast<ssize_t>(sizeof(s)) &&
+               fdatasync(fd_) == 0;
+    }
+
+    // Makes a newly created entry in `dir` survive a power cut
+    static void syncDirectory(const std::filesystem::path& dir)
+    {
+        int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd >= 0)
+        {
+            fsync(fd);
+            close(fd);
+        }
+    }
+
+    // Opens the file, creating it if needed, and restores the newest
+    // valid slot. Values it does not hold stay 0.
+    void load()
+    {
+        using namespace phosphor::logging;
+
+        pageSize_ = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+        std::filesystem::path file(path_);
+        std::error_code ec;
+        if (std::filesystem::create_directories(file.parent_path(), ec))
+        {
+            syncDirectory(file.parent_path().parent_path());
+        }
+
+        bool created = false;
+        fd_ = open(path_.c_str(), O_RDWR | O_CLOEXEC);
+        if (fd_ < 0 && errno == ENOENT)
+        {
+            fd_ = open(path_.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC,
+                       0600);
+            created = fd_ >= 0;
+        }
+        struct stat st
+        {};
+        if (fd_ < 0 || fstat(fd_, &st) < 0 ||
+            (static_cast<size_t>(st.st_size) < 2 * pageSize_ &&
+             ftruncate(fd_, 2 * pageSize_) < 0))
+        {
+            log<level::ERR>("Failed to open OEM config, not persisting",
+                entry("PATH=%s", path_.c_str()),
+                entry("ERRNO=%d", errno));
+            if (fd_ >= 0)
+            {
+                close(fd_);
+                fd_ = -1;
+            }
+            return;
+        }
+        if (created)
+        {
+            fsync(fd_);
+            syncDirectory(file.parent_path());
+        }
+
+        void* map = mmap(nullptr, 2 * pageSize_, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, fd_, 0);
+        if (map != MAP_FAILED)
+        {
+            map_ = static_cast<uint8_t*>(map);
+        }
+        else
+        {
+            log<level::INFO>("OEM config cannot be mapped, using pwrite",
+                entry("PATH=%s", path_.c_str()),
+                entry("ERRNO=%d", errno));
+        }
+
+        // With neither slot valid, the first commit goes to slot 0
+        current_ = 1;
+        Slot newest;
+        for (size_t i = 0; i < 2; ++i)
+        {
+            Slot s;
+            if (readSlot(i, s) && valid(s) &&
+                (!hasSaved_ || s.sequence > sequence_))
+            {
+                hasSaved_ = true;
+                current_ = i;
+                sequence_ = s.sequence;
+                newest = s;
+            }
+        }
+        if (hasSaved_)
+        {
+            std::memcpy(values_.data(), newest.values.data(),
+                        std::min<size_t>(newest.count, configCount));
+            saved_ = values_;
+        }
+    }
+
+    std::array<uint8_t, configCount> values_{};
+    boost::asio::steady_timer timer_;
+    bool flushPending_ = false;
+    std::chrono::milliseconds retryDelay_ = flushDelay; // after a failure
+
+    std::string path_;
+    int fd_ = -1;
+    uint8_t* map_ = nullptr; // null: pread/pwrite instead
+    size_t pageSize_ = 0;
+    size_t current_ = 0; // slot holding the last commit
+    uint64_t sequence_ = 0;
+    // The values in that slot, to skip commits that change nothing
+    std::array<uint8_t, configCount> saved_{};
+    bool hasSaved_ = false;
+};
+
+} // namespace myoem
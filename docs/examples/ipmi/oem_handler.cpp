@@ -15,14 +15,15 @@
  */
 
 #include "oem_handler.hpp"
+#include "config_store.hpp"
 
 #include <ipmid/api.hpp>
 #include <ipmid/utils.hpp>
 #include <phosphor-logging/log.hpp>
-#include <sdbusplus/bus.hpp>
+#include <boost/system/error_code.hpp>
 
 #include <array>
-#include <map>
+#include <memory>
 #include <string>
 
 using namespace phosphor::logging;
@@ -30,8 +31,9 @@ using namespace phosphor::logging;
 namespace myoem
 {
 
-// Simulated configuration storage (in production, use persistent storage)
-static std::map<uint8_t, uint8_t> configStorage;
+// Set/Get Config values, kept across restarts (config_store.hpp)
+static constexpr auto configPath = "/var/lib/myoem/config";
+static std::unique_ptr<ConfigStore> configStore;
 
 // Current version
 static constexpr VersionInfo currentVersion = {1, 0, 0};
@@ -63,14 +65,33 @@ ipmi::RspType<uint8_t, uint8_t, uint8_t>
         currentVersion.patch);
 }
 
+// LED group object for each LedId
+static constexpr std::array<const char*, 4> ledGroupPaths = {
+    "/xyz/openbmc_project/led/groups/enclosure_identify",
+    "/xyz/openbmc_project/led/groups/enclosure_fault",
+    "/xyz/openbmc_project/led/groups/power",
+    "/xyz/openbmc_project/led/groups/status",
+};
+static constexpr auto ledGroupInterface = "xyz.openbmc_project.Led.Group";
+
+// Service owning each LED group, looked up through the mapper on first use
+// and again only after a Set fails. Handlers all run on ipmid's main
+// thread, so no lock is needed.
+static std::array<std::string, ledGroupPaths.size()> ledGroupServices;
+
 /**
  * Set LED State
  *
  * Command: 0x02
  * Request: [led_id] [state]
  * Response: None
+ *
+ * Uses ipmid's own D-Bus connection through the request context. The
+ * property Set suspends this handler with ctx->yield instead of blocking,
+ * so ipmid keeps serving other commands until the reply comes back.
  */
-ipmi::RspType<> ipmiOemSetLed(uint8_t ledId, uint8_t state)
+ipmi::RspType<> ipmiOemSetLed(ipmi::Context::ptr ctx, uint8_t ledId,
+                              uint8_t state)
 {
     log<level::INFO>("OEM Set LED",
         entry("LED_ID=%d", ledId),
@@ -90,45 +111,37 @@ ipmi::RspType<> ipmiOemSetLed(uint8_t ledId, uint8_t state)
         return ipmi::responseParmOutOfRange();
     }
 
-    // Map LED ID to D-Bus path
-    std::string ledPath;
-    switch (static_cast<LedId>(ledId))
+    const char* ledPath = ledGroupPaths[ledId];
+
+    // Copied, since other requests may update the cache while this one
+    // is suspended
+    std::string service = ledGroupServices[ledId];
+    if (service.empty())
     {
-        case LedId::identify:
-            ledPath = "/xyz/openbmc_project/led/groups/enclosure_identify";
-            break;
-        case LedId::fault:
-            ledPath = "/xyz/openbmc_project/led/groups/enclosure_fault";
-            break;
-        case LedId::power:
-            ledPath = "/xyz/openbmc_project/led/groups/power";
-            break;
-        case LedId::status:
-            ledPath = "/xyz/openbmc_project/led/groups/status";
-            break;
+        boost::system::error_code ec =
+            ipmi::getService(ctx, ledGroupInterface, ledPath, service);
+        if (ec)
+        {
+            log<level::ERR>("Failed to find LED group service",
+                entry("PATH=%s", ledPath),
+                entry("ERROR=%s", ec.message().c_str()));
+            return ipmi::responseUnspecifiedError();
+        }
+        ledGroupServices[ledId] = service;
     }
 
     // Set LED via D-Bus
-    try
-    {
-        auto bus = sdbusplus::bus::new_default();
-        auto method = bus.new_method_call(
-            "xyz.openbmc_project.LED.GroupManager",
-            ledPath.c_str(),
-            "org.freedesktop.DBus.Properties",
-            "Set");
-
-        method.append("xyz.openbmc_project.Led.Group");
-        method.append("Asserted");
-        method.append(std::variant<bool>(state != 0));
-
-        bus.call(method);
-    }
-    catch (const sdbusplus::exception_t& e)
+    boost::system::error_code ec = ipmi::setDbusProperty(
+        ctx, service, ledPath, ledGroupInterface, "Asserted", state != 0);
+    if (ec)
     {
         log<level::ERR>("Failed to set LED",
-            entry("PATH=%s", ledPath.c_str()),
-            entry("ERROR=%s", e.what()));
+            entry("PATH=%s", ledPath),
+            entry("ERROR=%s", ec.message().c_str()));
+
+        // The service may have restarted under a new name; look it up
+        // again next time
+        ledGroupServices[ledId].clear();
         return ipmi::responseUnspecifiedError();
     }
 
@@ -175,11 +188,9 @@ ipmi::RspType<> ipmiOemSetConfig(uint8_t index, uint8_t value)
         return ipmi::responseParmOutOfRange();
     }
 
-    // Store configuration
-    configStorage[index] = value;
-
-    // In production, persist to storage
-    // Example: write to /var/lib/myoem/config
+    // Store configuration; written to flash shortly after, together with
+    // any other values set in the meantime
+    configStore->set(static_cast<ConfigIndex>(index), value);
 
     return ipmi::responseSuccess();
 }
@@ -201,15 +212,9 @@ ipmi::RspType<uint8_t> ipmiOemGetConfig(uint8_t index)
         return ipmi::responseParmOutOfRange();
     }
 
-    // Get configuration (default to 0 if not set)
-    uint8_t value = 0;
-    auto it = configStorage.find(index);
-    if (it != configStorage.end())
-    {
-        value = it->second;
-    }
-
-    return ipmi::responseSuccess(value);
+    // Get configuration (0 if never set)
+    return ipmi::responseSuccess(
+        configStore->get(static_cast<ConfigIndex>(index)));
 }
 
 /**
@@ -266,6 +271,9 @@ void registerHandlers()
 {
     log<level::INFO>("Registering OEM IPMI handlers");
 
+    // Restore the saved configuration before any command can read it
+    configStore = std::make_unique<ConfigStore>(*getIo(), configPath);
+
     // Get Version (User privilege)
     ipmi::registerHandler(
         ipmi::prioOemBase,
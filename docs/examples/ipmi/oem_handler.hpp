@@ -7,6 +7,7 @@
 #pragma once
 
 #include <ipmid/api-types.hpp>
+#include <cstddef>
 #include <cstdint>
 
 namespace myoem
@@ -82,6 +83,9 @@ enum class ConfigIndex : uint8_t
     debugLevel = 3
 };
 
+// Number of configuration values, one per ConfigIndex
+constexpr size_t configCount = static_cast<size_t>(ConfigIndex::debugLevel) + 1;
+
 // Function to register all OEM handlers
 void registerHandlers();
 
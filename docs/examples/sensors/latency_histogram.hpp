@@ -0,0 +1,147 @@
+/**
+ * Latency Histogram
+ *
+ * Fixed-size, log-linear histogram in the style of HdrHistogram, used by
+ * `sensor_reader --profile`.
+ *
+ * Values (microseconds) below 2^subBucketBits get one bucket each. Above
+ * that, every power of two is split into 2^(subBucketBits-1) equal
+ * buckets, so a reported percentile is within 1/64 (about 1.6%) of the
+ * true value at any magnitude. Recording is one bit_width and an array
+ * increment; there is no allocation after construction, and histograms of
+ * the same shape merge by adding counters.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+class LatencyHistogram
+{
+  public:
+    static constexpr unsigned subBucketBits = 7;
+    static constexpr uint64_t subBucketCount = uint64_t{1} << subBucketBits;
+    static constexpr uint64_t halfCount = subBucketCount / 2;
+    static constexpr unsigned valueBits = 40; // up to ~12 days in µs
+    static constexpr uint64_t highestValue = (uint64_t{1} << valueBits) - 1;
+    static constexpr size_t bucketCount =
+        subBucketCount + (valueBits - subBucketBits) * halfCount;
+
+    void record(uint64_t value)
+    {
+        value = std::min(value, highestValue);
+        ++counts_[indexOf(value)];
+        ++total_;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    void merge(const LatencyHistogram& other)
+    {
+        for (size_t i = 0; i < bucketCount; ++i)
+        {
+            counts_[i] += other.counts_[i];
+        }
+        total_ += other.total_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    uint64_t count() const
+    {
+        return total_;
+    }
+
+    uint64_t min() const
+    {
+        return total_ == 0 ? 0 : min_;
+    }
+
+    uint64_t max() const
+    {
+        return max_;
+    }
+
+    /**
+     * Smallest recorded value v such that `percentile` percent of all
+     * samples are <= v, reported as the top of v's bucket (never above
+     * the largest sample). 0 for an empty histogram.
+     */
+    uint64_t percentile(double percentile) const
+    {
+        if (total_ == 0)
+        {
+            return 0;
+        }
+        auto rank = static_cast<uint64_t>(
+            std::ceil(percentile / 100.0 * static_cast<double>(total_)));
+        rank = std::clamp<uint64_t>(rank, 1, total_);
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < bucketCount; ++i)
+        {
+            seen += counts_[i];
+            if (seen >= rank)
+            {
+                return std::min(highestIn(i), max_);
+            }
+        }
+        return max_;
+    }
+
+    static constexpr size_t indexOf(uint64_t value)
+    {
+        if (value < subBucketCount)
+        {
+            return static_cast<size_t>(value);
+        }
+        // Octave 1 holds [2^subBucketBits, 2^(subBucketBits+1)) and so on,
+        // each with a step of 2^octave
+        unsigned octave = static_cast<unsigned>(std::bit_width(value)) -
+                          subBucketBits;
+        uint64_t sub = (value >> octave) - halfCount;
+        return static_cast<size_t>(subBucketCount + (octave - 1) * halfCount +
+                                   sub);
+    }
+
+    static constexpr uint64_t lowestIn(size_t index)
+    {
+        if (index < subBucketCount)
+        {
+            return index;
+        }
+        uint64_t octave = (index - subBucketCount) / halfCount + 1;
+        uint64_t sub = (index - subBucketCount) % halfCount;
+        return (sub + halfCount) << octave;
+    }
+
+    static constexpr uint64_t highestIn(size_t index)
+    {
+        if (index < subBucketCount)
+        {
+            return index;
+        }
+        uint64_t octave = (index - subBucketCount) / halfCount + 1;
+        return lowestIn(index) + (uint64_t{1} << octave) - 1;
+    }
+
+  private:
+    std::array<uint64_t, bucketCount> counts_{};
+    uint64_t total_ = 0;
+    uint64_t min_ = UINT64_MAX;
+    uint64_t max_ = 0;
+};
+
+static_assert(LatencyHistogram::indexOf(127) == 127);
+static_assert(LatencyHistogram::indexOf(128) == 128);
+static_assert(LatencyHistogram::lowestIn(LatencyHistogram::indexOf(1000)) <=
+              1000);
+static_assert(LatencyHistogram::highestIn(LatencyHistogram::indexOf(1000)) >=
+              1000);
+static_assert(LatencyHistogram::indexOf(LatencyHistogram::highestValue) ==
+              LatencyHistogram::bucketCount - 1);
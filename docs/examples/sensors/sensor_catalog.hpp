@@ -0,0 +1,269 @@
+/**
+ * Sensor Catalog
+ *
+ * Parsed, interned view of the sensors returned by the Object Mapper.
+ *
+ * Every object path is parsed exactly once when it is added: the path,
+ * service and type strings are interned in a pool so identical tokens
+ * share storage, the name is a view into the interned path, and the unit
+ * is resolved through a compile-time perfect-hash table keyed by sensor
+ * type. Entries are stored as a structure of arrays and addressed by a
+ * dense index, so the per-row work of a scan or a watch redraw is plain
+ * array indexing with no string searching or copying.
+ *
+ * Sensor namespaces and units:
+ *   https://github.com/openbmc/phosphor-dbus-interfaces/blob/master/yaml/xyz/openbmc_project/Sensor/Value.interface.yaml
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace sensor_units
+{
+
+struct Entry
+{
+    std::string_view type; // path token: /xyz/openbmc_project/sensors/<type>/
+    std::string_view unit; // display unit
+};
+
+constexpr std::array<Entry, 14> table = {{
+    {"airflow", "CFM"},
+    {"altitude", "m"},
+    {"current", "A"},
+    {"energy", "J"},
+    {"fan_pwm", "%"},
+    {"fan_tach", "RPM"},
+    {"frequency", "Hz"},
+    {"humidity", "%RH"},
+    {"liquidflow", "LPM"},
+    {"power", "W"},
+    {"pressure", "Pa"},
+    {"temperature", "°C"},
+    {"utilization", "%"},
+    {"voltage", "V"},
+}};
+
+constexpr unsigned slotBits = 5; // 32 slots for 14 types
+constexpr size_t slotCount = size_t{1} << slotBits;
+constexpr uint8_t emptySlot = 0xff;
+
+// FNV-1a with the seed folded into the offset basis
+constexpr uint32_t hash(std::string_view text, uint32_t seed)
+{
+    uint32_t h = 2166136261u ^ seed;
+    for (char c : text)
+    {
+        h ^= static_cast<uint8_t>(c);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// The top bits of FNV-1a depend on every input byte and on the whole
+// seed; the low bits only see the low bits of each, so use the top ones
+constexpr size_t slotOf(std::string_view text, uint32_t seed)
+{
+    return hash(text, seed) >> (32 - slotBits);
+}
+
+constexpr bool collisionFree(uint32_t seed)
+{
+    std::array<bool, slotCount> used{};
+    for (const auto& entry : table)
+    {
+        auto slot = slotOf(entry.type, seed);
+        if (used[slot])
+        {
+            return false;
+        }
+        used[slot] = true;
+    }
+    return true;
+}
+
+// Search for a seed that gives every type its own slot
+constexpr uint32_t findSeed()
+{
+    for (uint32_t seed = 0; seed < 100000; ++seed)
+    {
+        if (collisionFree(seed))
+        {
+            return seed;
+        }
+    }
+    return UINT32_MAX;
+}
+
+constexpr uint32_t seed = findSeed();
+static_assert(seed != UINT32_MAX, "no perfect hash seed for unit table");
+
+constexpr std::array<uint8_t, slotCount> buildSlots()
+{
+    std::array<uint8_t, slotCount> slots{};
+    for (auto& slot : slots)
+    {
+        slot = emptySlot;
+    }
+    for (size_t i = 0; i < table.size(); ++i)
+    {
+        slots[slotOf(table[i].type, seed)] = static_cast<uint8_t>(i);
+    }
+    return slots;
+}
+
+constexpr auto slots = buildSlots();
+
+// Index into `table`, or emptySlot for an unknown type. One hash and one
+// string compare, no probing.
+constexpr uint8_t find(std::string_view type)
+{
+    uint8_t index = slots[slotOf(type, seed)];
+    if (index == emptySlot || table[index].type != type)
+    {
+        return emptySlot;
+    }
+    return index;
+}
+
+constexpr std::string_view unitOf(uint8_t index)
+{
+    return index == emptySlot ? std::string_view{} : table[index].unit;
+}
+
+static_assert(unitOf(find("temperature")) == "°C");
+static_assert(unitOf(find("fan_tach")) == "RPM");
+static_assert(find("not_a_type") == emptySlot);
+
+} // namespace sensor_units
+
+/**
+ * Owns one copy of every distinct string and hands out stable views.
+ * std::deque never moves its elements on push_back, so views stay valid
+ * for the lifetime of the pool.
+ */
+class StringPool
+{
+  public:
+    std::string_view intern(std::string_view text)
+    {
+        auto it = index_.find(text);
+        if (it != index_.end())
+        {
+            return *it;
+        }
+        std::string_view stored = storage_.emplace_back(text);
+        index_.insert(stored);
+        return stored;
+    }
+
+  private:
+    std::deque<std::string> storage_;
+    std::unordered_set<std::string_view> index_;
+};
+
+// All display fields of one catalog entry
+struct SensorInfo
+{
+    std::string_view path;
+    std::string_view name;
+    std::string_view type;
+    std::string_view unit;
+    std::string_view service;
+};
+
+class SensorCatalog
+{
+  public:
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    // Add one (path, service) pair and return its index
+    uint32_t add(std::string_view path, std::string_view service)
+    {
+        constexpr std::string_view prefix = "/xyz/openbmc_project/sensors/";
+
+        auto storedPath = pool_.intern(path);
+        std::string_view name = storedPath;
+        std::string_view type = "unknown";
+
+        auto slash = storedPath.rfind('/');
+        if (slash != std::string_view::npos)
+        {
+            name = storedPath.substr(slash + 1);
+        }
+        // Extract type from /xyz/openbmc_project/sensors/<type>/<name>
+        if (storedPath.starts_with(prefix))
+        {
+            auto remainder = storedPath.substr(prefix.size());
+            auto end = remainder.find('/');
+            if (end != std::string_view::npos)
+            {
+                type = remainder.substr(0, end);
+            }
+        }
+
+        auto index = static_cast<uint32_t>(paths_.size());
+        paths_.push_back(storedPath);
+        names_.push_back(name);
+        types_.push_back(pool_.intern(type));
+        units_.push_back(sensor_units::find(type));
+        services_.push_back(pool_.intern(service));
+        byPath_.try_emplace(storedPath, index);
+        return index;
+    }
+
+    size_t size() const
+    {
+        return paths_.size();
+    }
+
+    // First entry for an object path, or npos
+    uint32_t find(std::string_view path) const
+    {
+        auto it = byPath_.find(path);
+        return it == byPath_.end() ? npos : it->second;
+    }
+
+    SensorInfo info(uint32_t index) const
+    {
+        return {paths_[index], names_[index], types_[index],
+                sensor_units::unitOf(units_[index]), services_[index]};
+    }
+
+    std::string_view path(uint32_t index) const
+    {
+        return paths_[index];
+    }
+
+    std::string_view service(uint32_t index) const
+    {
+        return services_[index];
+    }
+
+    // Services change when a hot-plugged sensor's owner is resolved
+    void setService(uint32_t index, std::string_view service)
+    {
+        services_[index] = pool_.intern(service);
+    }
+
+  private:
+    StringPool pool_;
+
+    // Structure of arrays, all indexed by entry
+    std::vector<std::string_view> paths_;
+    std::vector<std::string_view> names_;
+    std::vector<std::string_view> types_;
+    std::vector<uint8_t> units_; // index into sensor_units::table
+    std::vector<std::string_view> services_;
+
+    std::unordered_map<std::string_view, uint32_t> byPath_;
+};
@@ -4,6 +4,31 @@
  * Reads and displays sensor values from D-Bus.
  * Demonstrates using Object Mapper to discover sensors.
  *
+ * By default values are fetched in bulk: the mapper subtree is grouped by
+ * service and each service is asked once via ObjectManager
+ * GetManagedObjects. Services without an ObjectManager fall back to one
+ * Properties.Get per sensor, which is what --per-sensor forces for all.
+ * All reads are pipelined (--jobs in flight, each bounded by --timeout-ms)
+ * so one slow daemon shows as "N/A (timeout)" instead of stalling the scan.
+ *
+ * --format=json|csv|bin emit machine-readable output for collectors. All
+ * formats share one reusable output buffer and std::to_chars, so rows are
+ * produced without per-row string or stream allocations. Paths are parsed
+ * once into a SensorCatalog (sensor_catalog.hpp) that every mode shares.
+ *
+ * With --watch the table is read once and then kept current from
+ * PropertiesChanged and InterfacesAdded/Removed signals, redrawing only
+ * the rows that changed. No polling happens while watching.
+ *
+ * --profile times the mapper lookup and every read on the monotonic clock
+ * and prints per-service p50/p95/p99/max (latency_histogram.hpp) plus the
+ * slowest sensors, optionally over several scans (--repeat).
+ *
+ * --cache[=DIR] keeps the resolved mapper subtree on disk
+ * (subtree_cache.hpp) so repeated runs skip GetSubTree. A cache file is
+ * used only while every service keeps its unique bus name and no
+ * `--watch --cache` process has seen sensors appear or disappear since.
+ *
  * Source Reference:
  *   - dbus-sensors: https://github.com/openbmc/dbus-sensors
  *   - Sensor interfaces: https://github.com/openbmc/phosphor-dbus-interfaces/tree/master/yaml/xyz/openbmc_project/Sensor
@@ -19,14 +44,46 @@
  *   ./sensor_reader voltage      # List voltage sensors
  *   ./sensor_reader power        # List power sensors
  *   ./sensor_reader fan          # List fan sensors
+ *   ./sensor_reader --per-sensor # One Properties.Get per sensor (slow path)
+ *   ./sensor_reader --watch      # Live table updated from PropertiesChanged
+ *   ./sensor_reader --jobs=32 --timeout-ms=500
+ *                                # Reads in flight at once, per-call timeout
+ *   ./sensor_reader --format=json  # Also csv, or bin (see sensor_record.hpp)
+ *   ./sensor_reader --cache      # Reuse the subtree from /run/sensor_reader
+ *   ./sensor_reader --profile --repeat=20 --slowest=5
+ *                                # Latency report per service over 20 scans
  */
 
+#include <sdbusplus/asio/connection.hpp>
 #include <sdbusplus/bus.hpp>
-#include <iostream>
+#include <sdbusplus/bus/match.hpp>
+#include <sdbusplus/exception.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/signal_set.hpp>
+#include "latency_histogram.hpp"
+#include "sensor_catalog.hpp"
+#include "sensor_record.hpp"
+#include "subtree_cache.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <deque>
 #include <iomanip>
+#include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
 #include <variant>
 
 constexpr auto objectMapperService = "xyz.openbmc_project.ObjectMapper";
@@ -34,151 +91,1599 @@ constexpr auto objectMapperPath = "/xyz/openbmc_project/object_mapper";
 constexpr auto objectMapperInterface = "xyz.openbmc_project.ObjectMapper";
 constexpr auto sensorValueInterface = "xyz.openbmc_project.Sensor.Value";
 constexpr auto sensorBasePath = "/xyz/openbmc_project/sensors";
+constexpr auto objectManagerInterface = "org.freedesktop.DBus.ObjectManager";
+constexpr auto propertiesInterface = "org.freedesktop.DBus.Properties";
 
-// Get unit string for display
-std::string getUnitDisplay(const std::string& path)
-{
-    if (path.find("/temperature/") != std::string::npos)
-        return "°C";
-    if (path.find("/voltage/") != std::string::npos)
-        return "V";
-    if (path.find("/power/") != std::string::npos)
-        return "W";
-    if (path.find("/current/") != std::string::npos)
-        return "A";
-    if (path.find("/fan_tach/") != std::string::npos)
-        return "RPM";
-    if (path.find("/fan_pwm/") != std::string::npos)
-        return "%";
-    return "";
-}
+// Paths where daemons commonly host their ObjectManager: phosphor-hwmon
+// uses the sensor root, sdbusplus::asio::object_server defaults to "/".
+const std::vector<std::string> objectManagerPaths = {sensorBasePath, "/"};
 
-// Extract sensor name from path
-std::string getSensorName(const std::string& path)
+// Mapper result: map<path, map<service, interfaces>>
+using SubTree =
+    std::map<std::string, std::map<std::string, std::vector<std::string>>>;
+
+// Property types found on sensor objects (Value, thresholds, decorators,
+// associations). sdbusplus skips a property of any other type while
+// decoding and stores a default PropertyValue, so it reads as double 0.0.
+using PropertyValue =
+    std::variant<double, int64_t, uint64_t, int32_t, uint32_t, int16_t,
+                 uint16_t, uint8_t, bool, std::string,
+                 std::vector<std::string>,
+                 std::vector<std::tuple<std::string, std::string,
+                                        std::string>>>;
+using ManagedObjects = std::map<
+    sdbusplus::message::object_path,
+    std::map<std::string, std::map<std::string, PropertyValue>>>;
+
+// Outcome of reading one sensor
+struct Reading
+{
+    std::optional<double> value;
+    bool timedOut = false;
+};
+
+// Sensor readings indexed like the SensorCatalog entries
+using SensorValues = std::vector<Reading>;
+
+/**
+ * Latencies gathered by --profile, accumulated over repeated scans.
+ *
+ * Every D-Bus call is timed on the monotonic clock from the moment it is
+ * sent to its reply (queueing inside our own window is excluded, so the
+ * numbers describe the daemon). Each sensor is charged the latency of the
+ * call that delivered its value: its own Properties.Get, or the bulk
+ * GetManagedObjects of its service.
+ */
+class ReadProfile
 {
-    auto pos = path.rfind('/');
-    if (pos != std::string::npos)
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Call
+    {
+        managedObjects,
+        get
+    };
+
+    enum class Outcome
+    {
+        ok,
+        error,
+        timeout
+    };
+
+    static uint64_t micros(Clock::duration elapsed)
     {
-        return path.substr(pos + 1);
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(elapsed)
+                .count());
     }
-    return path;
-}
 
-// Get sensor type from path
-std::string getSensorType(const std::string& path)
-{
-    // Extract type from /xyz/openbmc_project/sensors/<type>/<name>
-    std::string prefix = "/xyz/openbmc_project/sensors/";
-    if (path.find(prefix) == 0)
+    void recordMapper(Clock::duration elapsed, bool cached)
+    {
+        (cached ? cacheHits_ : mapper_).record(micros(elapsed));
+    }
+
+    void recordCall(std::string_view service, Clock::duration elapsed,
+                    Outcome outcome)
+    {
+        auto& stats = serviceStats(service);
+        stats.latency.record(micros(elapsed));
+        stats.errors += outcome == Outcome::error;
+        stats.timeouts += outcome == Outcome::timeout;
+    }
+
+    void recordSensor(std::string_view path, std::string_view service,
+                      Call via, Clock::duration elapsed)
     {
-        auto remainder = path.substr(prefix.length());
-        auto pos = remainder.find('/');
-        if (pos != std::string::npos)
+        auto it = sensors_.find(path);
+        if (it == sensors_.end())
+        {
+            it = sensors_.emplace(std::string(path), SensorStats{}).first;
+        }
+        uint64_t us = micros(elapsed);
+        if (us >= it->second.worst)
         {
-            return remainder.substr(0, pos);
+            it->second = SensorStats{std::string(service), via, us};
         }
     }
-    return "unknown";
-}
 
-int main(int argc, char* argv[])
-{
-    std::string filterType;
-    if (argc > 1)
+    void endScan()
     {
-        filterType = argv[1];
+        ++scans_;
     }
 
-    try
+    void report(std::ostream& os, size_t slowest) const
     {
-        auto bus = sdbusplus::bus::new_default();
+        os << "Profile: " << scans_ << (scans_ == 1 ? " scan, " : " scans, ")
+           << sensors_.size() << " sensors, " << services_.size()
+           << " services (latency in ms)\n\n";
 
-        // Build search path
-        std::string searchPath = sensorBasePath;
-        if (!filterType.empty() && filterType != "all")
+        os << std::left << std::setw(40) << "Call" << std::right
+           << std::setw(7) << "Count" << std::setw(9) << "p50"
+           << std::setw(9) << "p95" << std::setw(9) << "p99" << std::setw(9)
+           << "Max" << std::setw(7) << "Errors" << std::setw(9) << "Timeouts"
+           << "\n";
+        os << std::string(99, '-') << "\n";
+        histogramRow(os, "mapper GetSubTree", mapper_, 0, 0);
+        histogramRow(os, "subtree cache hit", cacheHits_, 0, 0);
+        for (const auto& [service, stats] : services_)
         {
-            searchPath += "/" + filterType;
+            histogramRow(os, service, stats.latency, stats.errors,
+                         stats.timeouts);
         }
 
-        // Use Object Mapper to find sensors
-        auto method = bus.new_method_call(
-            objectMapperService, objectMapperPath, objectMapperInterface,
-            "GetSubTree");
+        std::vector<const SensorEntry*> worst;
+        worst.reserve(sensors_.size());
+        for (const auto& entry : sensors_)
+        {
+            worst.push_back(&entry);
+        }
+        slowest = std::min(slowest, worst.size());
+        std::partial_sort(worst.begin(), worst.begin() + slowest, worst.end(),
+                          [](const SensorEntry* a, const SensorEntry* b) {
+                              return a->second.worst > b->second.worst;
+                          });
+
+        os << "\nSlowest " << slowest << " sensors (worst of " << scans_
+           << (scans_ == 1 ? " scan" : " scans") << ")\n\n";
+        os << std::left << std::setw(40) << "Sensor" << std::setw(40)
+           << "Service" << std::setw(8) << "Via" << std::right
+           << std::setw(9) << "ms" << "\n";
+        os << std::string(97, '-') << "\n";
+        for (size_t i = 0; i < slowest; ++i)
+        {
+            const auto& [path, stats] = *worst[i];
+            auto name = std::string_view(path).substr(path.rfind('/') + 1);
+            os << std::left << std::setw(40) << name << std::setw(40)
+               << stats.service << std::setw(8)
+               << (stats.via == Call::get ? "Get" : "Managed") << std::right
+               << std::setw(9) << millis(stats.worst) << "\n";
+        }
+    }
+
+  private:
+    struct ServiceStats
+    {
+        LatencyHistogram latency;
+        uint64_t errors = 0;
+        uint64_t timeouts = 0;
+    };
+
+    struct SensorStats
+    {
+        std::string service;
+        Call via = Call::get;
+        uint64_t worst = 0; // µs
+    };
 
-        method.append(searchPath);
-        method.append(0); // depth
-        std::vector<std::string> interfaces = {sensorValueInterface};
-        method.append(interfaces);
+    using SensorEntry = std::pair<const std::string, SensorStats>;
 
-        auto reply = bus.call(method);
+    static std::string millis(uint64_t us)
+    {
+        std::array<char, 32> buf{};
+        auto [end, ec] = std::to_chars(buf.data(), buf.data() + buf.size(),
+                                       static_cast<double>(us) / 1000.0,
+                                       std::chars_format::fixed, 2);
+        return std::string(buf.data(), end);
+    }
 
-        // Parse response: map<path, map<service, interfaces>>
-        std::map<std::string,
-                 std::map<std::string, std::vector<std::string>>>
-            results;
-        reply.read(results);
+    static void histogramRow(std::ostream& os, std::string_view label,
+                             const LatencyHistogram& h, uint64_t errors,
+                             uint64_t timeouts)
+    {
+        if (h.count() == 0)
+        {
+            return;
+        }
+        os << std::left << std::setw(40) << label << std::right
+           << std::setw(7) << h.count() << std::setw(9)
+           << millis(h.percentile(50)) << std::setw(9)
+           << millis(h.percentile(95)) << std::setw(9)
+           << millis(h.percentile(99)) << std::setw(9) << millis(h.max())
+           << std::setw(7) << errors << std::setw(9) << timeouts << "\n";
+    }
 
-        if (results.empty())
+    ServiceStats& serviceStats(std::string_view service)
+    {
+        auto it = services_.find(service);
+        if (it == services_.end())
         {
-            std::cout << "No sensors found";
-            if (!filterType.empty())
+            it = services_.emplace(std::string(service), ServiceStats{}).first;
+        }
+        return it->second;
+    }
+
+    // Catalogs are rebuilt every scan, so keys own their strings
+    LatencyHistogram mapper_;
+    LatencyHistogram cacheHits_;
+    std::map<std::string, ServiceStats, std::less<>> services_;
+    std::map<std::string, SensorStats, std::less<>> sensors_;
+    size_t scans_ = 0;
+};
+
+/**
+ * Pipelined value reader.
+ *
+ * Issues every read with async_method_call_timed and keeps up to `window`
+ * calls in flight on one connection, so wall-clock time for a scan tracks
+ * the slowest service rather than the sum of all round trips. Results are
+ * indexed by catalog entry, so completion order never affects output order.
+ *
+ * A hung daemon is contained three ways: each call has its own timeout, no
+ * service may occupy more than half the window, and once a service has
+ * timed out its remaining queued reads are failed without being sent.
+ */
+class AsyncReader
+{
+  public:
+    AsyncReader(sdbusplus::asio::connection& conn, size_t window,
+                std::chrono::milliseconds timeout) :
+        conn_(conn), window_(std::max<size_t>(window, 1)),
+        serviceLimit_(std::max<size_t>(window_ / 2, 1)),
+        timeoutUs_(std::chrono::duration_cast<std::chrono::microseconds>(
+                       timeout)
+                       .count())
+    {}
+
+    // Read every catalog entry, one GetManagedObjects per service where an
+    // ObjectManager exists, one Properties.Get per sensor otherwise or
+    // where its reply holds no Value for the sensor. Call
+    // latencies go to `profile` when one is given.
+    SensorValues readAll(const SensorCatalog& catalog, bool perSensor,
+                         ReadProfile* profile = nullptr)
+    {
+        catalog_ = &catalog;
+        profile_ = profile;
+        values_.assign(catalog.size(), Reading{});
+
+        // Group entries by owning service
+        for (uint32_t entry = 0; entry < catalog.size(); ++entry)
+        {
+            entriesByService_[catalog.service(entry)].push_back(entry);
+        }
+
+        for (const auto& [service, entries] : entriesByService_)
+        {
+            if (perSensor)
             {
-                std::cout << " of type: " << filterType;
+                queueGets(service);
             }
-            std::cout << "\n";
-            return 0;
+            else
+            {
+                queue_.push_back(Job{service, SensorCatalog::npos, 0});
+            }
+        }
+
+        // Drive the shared io_context only until our own calls complete,
+        // leaving any other handlers (watch matches) untouched
+        auto& io = conn_.get_io_context();
+        pump();
+        while (inFlight_ > 0)
+        {
+            io.run_one();
+        }
+        return std::move(values_);
+    }
+
+  private:
+    struct Job
+    {
+        std::string_view service;
+        uint32_t entry; // npos: GetManagedObjects for the whole service
+        size_t managerIndex;
+        ReadProfile::Clock::time_point sent{};
+    };
+
+    static bool isTimeout(const boost::system::error_code& ec)
+    {
+        return ec.value() == ETIMEDOUT;
+    }
+
+    void queueGets(std::string_view service)
+    {
+        for (auto entry : entriesByService_[service])
+        {
+            queue_.push_back(Job{service, entry, 0});
+        }
+    }
+
+    // Start queued jobs until the window is full or every remaining job
+    // belongs to a service already at its share of the window
+    void pump()
+    {
+        auto it = queue_.begin();
+        while (inFlight_ < window_ && it != queue_.end())
+        {
+            Job job = *it;
+            if (timedOut_.contains(job.service))
+            {
+                it = queue_.erase(it);
+                markTimedOut(job);
+                continue;
+            }
+            if (inFlightByService_[job.service] >= serviceLimit_)
+            {
+                ++it;
+                continue;
+            }
+            it = queue_.erase(it);
+
+            if (profile_ != nullptr)
+            {
+                job.sent = ReadProfile::Clock::now();
+            }
+            ++inFlight_;
+            ++inFlightByService_[job.service];
+            if (job.entry == SensorCatalog::npos)
+            {
+                startManaged(job);
+            }
+            else
+            {
+                startGet(job);
+            }
+        }
+    }
+
+    void complete(const Job& job, const boost::system::error_code& ec)
+    {
+        --inFlight_;
+        --inFlightByService_[job.service];
+        if (profile_ == nullptr)
+        {
+            return;
+        }
+
+        auto elapsed = ReadProfile::Clock::now() - job.sent;
+        auto outcome = !ec              ? ReadProfile::Outcome::ok
+                       : isTimeout(ec) ? ReadProfile::Outcome::timeout
+                                       : ReadProfile::Outcome::error;
+        profile_->recordCall(job.service, elapsed, outcome);
+        if (ec)
+        {
+            return;
+        }
+        if (job.entry != SensorCatalog::npos)
+        {
+            profile_->recordSensor(catalog_->path(job.entry), job.service,
+                                   ReadProfile::Call::get, elapsed);
+            return;
+        }
+        for (auto entry : entriesByService_[job.service])
+        {
+            profile_->recordSensor(catalog_->path(entry), job.service,
+                                   ReadProfile::Call::managedObjects, elapsed);
+        }
+    }
+
+    void markTimedOut(const Job& job)
+    {
+        if (job.entry != SensorCatalog::npos)
+        {
+            values_[job.entry].timedOut = true;
+            return;
+        }
+        for (auto entry : entriesByService_[job.service])
+        {
+            values_[entry].timedOut = true;
         }
+    }
 
-        // Print header
-        std::cout << std::left << std::setw(30) << "Sensor"
-                  << std::setw(12) << "Type"
-                  << std::setw(15) << "Value"
-                  << "Service" << "\n";
-        std::cout << std::string(80, '-') << "\n";
+    void startManaged(const Job& job)
+    {
+        conn_.async_method_call_timed(
+            [this, job](const boost::system::error_code& ec,
+                        const ManagedObjects& objects) {
+                complete(job, ec);
+                if (!ec)
+                {
+                    storeManaged(job.service, objects);
+                }
+                else if (isTimeout(ec))
+                {
+                    timedOut_.insert(job.service);
+                    markTimedOut(job);
+                }
+                else if (job.managerIndex + 1 < objectManagerPaths.size())
+                {
+                    // No ObjectManager here, try the next candidate path
+                    queue_.push_front(Job{job.service, SensorCatalog::npos,
+                                          job.managerIndex + 1});
+                }
+                else
+                {
+                    // Fallback: service does not implement ObjectManager
+                    queueGets(job.service);
+                }
+                pump();
+            },
+            std::string(job.service), objectManagerPaths[job.managerIndex],
+            objectManagerInterface, "GetManagedObjects", timeoutUs_);
+    }
 
-        // Read and display each sensor
-        for (const auto& [path, services] : results)
+    // Sensors the reply does not hold a Value for (e.g. an ObjectManager
+    // that covers only part of the service) get a Get each
+    void storeManaged(std::string_view service, const ManagedObjects& objects)
+    {
+        for (auto entry : entriesByService_[service])
         {
-            for (const auto& [service, ifaces] : services)
+            if (const double* value = managedValue(objects, entry))
+            {
+                values_[entry].value = *value;
+            }
+            else
             {
-                try
+                queue_.push_back(Job{service, entry, 0});
+            }
+        }
+    }
+
+    const double* managedValue(const ManagedObjects& objects,
+                               uint32_t entry) const
+    {
+        auto obj = objects.find(sdbusplus::message::object_path(
+            std::string(catalog_->path(entry))));
+        if (obj == objects.end())
+        {
+            return nullptr;
+        }
+        auto iface = obj->second.find(sensorValueInterface);
+        if (iface == obj->second.end())
+        {
+            return nullptr;
+        }
+        auto prop = iface->second.find("Value");
+        if (prop == iface->second.end())
+        {
+            return nullptr;
+        }
+        return std::get_if<double>(&prop->second);
+    }
+
+    void startGet(const Job& job)
+    {
+        conn_.async_method_call_timed(
+            [this, job](const boost::system::error_code& ec,
+                        const std::variant<double>& value) {
+                complete(job, ec);
+                Reading& reading = values_[job.entry];
+                if (!ec)
                 {
-                    // Get Value property
-                    auto getProperty = bus.new_method_call(
-                        service.c_str(), path.c_str(),
-                        "org.freedesktop.DBus.Properties", "Get");
-                    getProperty.append(sensorValueInterface, "Value");
-
-                    auto propReply = bus.call(getProperty);
-                    std::variant<double> valueVariant;
-                    propReply.read(valueVariant);
-
-                    double value = std::get<double>(valueVariant);
-                    std::string unit = getUnitDisplay(path);
-                    std::string name = getSensorName(path);
-                    std::string type = getSensorType(path);
-
-                    // Format value with unit
-                    std::ostringstream valueStr;
-                    valueStr << std::fixed << std::setprecision(2) << value
-                             << " " << unit;
-
-                    std::cout << std::left << std::setw(30) << name
-                              << std::setw(12) << type
-                              << std::setw(15) << valueStr.str()
-                              << service << "\n";
+                    reading.value = std::get<double>(value);
                 }
-                catch (const std::exception& e)
+                else if (isTimeout(ec))
                 {
-                    std::cout << std::left << std::setw(30) << getSensorName(path)
-                              << std::setw(12) << getSensorType(path)
-                              << std::setw(15) << "N/A"
-                              << service << "\n";
+                    reading.timedOut = true;
+                    timedOut_.insert(job.service);
                 }
+                pump();
+            },
+            std::string(job.service), std::string(catalog_->path(job.entry)),
+            propertiesInterface, "Get", timeoutUs_, sensorValueInterface,
+            "Value");
+    }
+
+    sdbusplus::asio::connection& conn_;
+    const size_t window_;
+    const size_t serviceLimit_;
+    const uint64_t timeoutUs_;
+
+    // Service names are views into the catalog's string pool
+    const SensorCatalog* catalog_ = nullptr;
+    ReadProfile* profile_ = nullptr;
+    std::map<std::string_view, std::vector<uint32_t>> entriesByService_;
+    std::deque<Job> queue_;
+    size_t inFlight_ = 0;
+    std::map<std::string_view, size_t> inFlightByService_;
+    std::set<std::string_view> timedOut_;
+    SensorValues values_;
+};
+
+// Parse every (path, service) pair of a mapper result into the catalog
+void addSubTree(SensorCatalog& catalog, const SubTree& subtree)
+{
+    for (const auto& [path, services] : subtree)
+    {
+        for (const auto& [service, ifaces] : services)
+        {
+            catalog.add(path, service);
+        }
+    }
+}
+
+// Query the mapper for every Sensor.Value object under searchPath
+SubTree getSensorSubTree(sdbusplus::bus_t& bus, const std::string& searchPath)
+{
+    auto method = bus.new_method_call(
+        objectMapperService, objectMapperPath, objectMapperInterface,
+        "GetSubTree");
+
+    method.append(searchPath);
+    method.append(0); // depth
+    std::vector<std::string> interfaces = {sensorValueInterface};
+    method.append(interfaces);
+
+    auto reply = bus.call(method);
+
+    SubTree results;
+    reply.read(results);
+    return results;
+}
+
+// Unique name (":1.42") currently owning a well-known bus name
+std::string getNameOwner(sdbusplus::bus_t& bus, const std::string& name)
+{
+    auto method = bus.new_method_call(
+        "org.freedesktop.DBus", "/org/freedesktop/DBus",
+        "org.freedesktop.DBus", "GetNameOwner");
+    method.append(name);
+
+    auto reply = bus.call(method);
+    std::string owner;
+    reply.read(owner);
+    return owner;
+}
+
+// A cached subtree is stale once any of its services changed owner
+bool ownersUnchanged(sdbusplus::bus_t& bus,
+                     const subtree_cache::Snapshot& snapshot)
+{
+    try
+    {
+        for (size_t i = 0; i < snapshot.serviceCount(); ++i)
+        {
+            if (getNameOwner(bus, std::string(snapshot.serviceName(i))) !=
+                snapshot.serviceOwner(i))
+            {
+                return false;
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        return false; // service is gone
+    }
+    return true;
+}
+
+/**
+ * Fill the catalog for searchPath.
+ *
+ * With a cache directory, a valid cache file replaces the GetSubTree call
+ * (one GetNameOwner per service to the bus daemon instead). On a miss the
+ * mapper result is written back for the next run. Returns true on a hit.
+ */
+bool loadCatalog(sdbusplus::bus_t& bus, SensorCatalog& catalog,
+                 const std::string& searchPath, std::string_view filter,
+                 const std::string& cacheDir)
+{
+    if (cacheDir.empty())
+    {
+        addSubTree(catalog, getSensorSubTree(bus, searchPath));
+        return false;
+    }
+
+    // Read the stamp before asking the mapper, so a change that lands
+    // while we rebuild leaves the file we write already stale
+    auto file = subtree_cache::cacheFile(cacheDir, filter);
+    auto generation = subtree_cache::readGeneration(cacheDir);
+
+    subtree_cache::Snapshot snapshot;
+    if (snapshot.load(file) && snapshot.generation() == generation &&
+        ownersUnchanged(bus, snapshot))
+    {
+        if (snapshot.fill(catalog))
+        {
+            return true;
+        }
+        catalog = SensorCatalog{}; // corrupt file, drop partial entries
+    }
+
+    addSubTree(catalog, getSensorSubTree(bus, searchPath));
+
+    std::map<std::string, std::string> owners;
+    try
+    {
+        for (uint32_t entry = 0; entry < catalog.size(); ++entry)
+        {
+            std::string service(catalog.service(entry));
+            if (!owners.contains(service))
+            {
+                owners[service] = getNameOwner(bus, service);
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        return false; // an owner vanished meanwhile; do not cache
+    }
+    subtree_cache::save(file, generation, catalog, owners);
+    return false;
+}
+
+enum class OutputFormat
+{
+    table,
+    json,
+    csv,
+    bin
+};
+
+/**
+ * Row formatter for every output mode.
+ *
+ * All formats append into one reusable buffer that is handed to stdout in
+ * large chunks. Numbers go through std::to_chars and names, types and
+ * units come pre-parsed from the SensorCatalog as string_views, so once
+ * the buffer has reached its working size formatting a row performs no
+ * heap allocation and no string searching.
+ */
+class SensorWriter
+{
+  public:
+    explicit SensorWriter(OutputFormat format) : format_(format)
+    {
+        buf_.reserve(flushThreshold * 2);
+    }
+
+    ~SensorWriter()
+    {
+        flush();
+    }
+
+    SensorWriter(const SensorWriter&) = delete;
+    SensorWriter& operator=(const SensorWriter&) = delete;
+
+    // Start a document holding `count` rows
+    void begin(size_t count)
+    {
+        switch (format_)
+        {
+            case OutputFormat::table:
+                header();
+                break;
+            case OutputFormat::json:
+                append("[");
+                break;
+            case OutputFormat::csv:
+                append("name,type,value,unit,service,status\n");
+                break;
+            case OutputFormat::bin:
+            {
+                sensor_record::FileHeader file{};
+                file.magic = sensor_record::magic;
+                file.version = sensor_record::version;
+                file.headerSize = sizeof(file);
+                file.count = static_cast<uint32_t>(count);
+                appendBytes(&file, sizeof(file));
+                break;
             }
         }
+    }
+
+    void row(const SensorInfo& info, const Reading& reading)
+    {
+        switch (format_)
+        {
+            case OutputFormat::table:
+                tableRow(info, reading);
+                break;
+            case OutputFormat::json:
+                jsonRow(info, reading);
+                break;
+            case OutputFormat::csv:
+                csvRow(info, reading);
+                break;
+            case OutputFormat::bin:
+                binRow(info, reading);
+                break;
+        }
+        ++rows_;
+        if (buf_.size() >= flushThreshold)
+        {
+            flush();
+        }
+    }
+
+    void end()
+    {
+        if (format_ == OutputFormat::table)
+        {
+            append("\nTotal: ");
+            appendUnsigned(rows_);
+            append(" sensors\n");
+        }
+        else if (format_ == OutputFormat::json)
+        {
+            append(rows_ == 0 ? "]\n" : "\n]\n");
+        }
+        flush();
+    }
+
+    void header()
+    {
+        appendPadded("Sensor", 30);
+        appendPadded("Type", 12);
+        appendPadded("Value", 15);
+        append("Service\n");
+        buf_.append(80, '-');
+        append("\n");
+    }
+
+    void append(std::string_view text)
+    {
+        buf_.append(text);
+    }
+
+    void appendUnsigned(uint64_t number)
+    {
+        char tmp[24];
+        auto [end, ec] = std::to_chars(tmp, tmp + sizeof(tmp), number);
+        buf_.append(tmp, end);
+    }
 
-        std::cout << "\nTotal: " << results.size() << " sensors\n";
+    void flush()
+    {
+        if (!buf_.empty())
+        {
+            std::fwrite(buf_.data(), 1, buf_.size(), stdout);
+            buf_.clear(); // keeps capacity for the next rows
+        }
+        std::fflush(stdout);
+    }
+
+  private:
+    static constexpr size_t flushThreshold = 64 * 1024;
+
+    static std::string_view statusName(const Reading& reading)
+    {
+        if (reading.value)
+        {
+            return "ok";
+        }
+        return reading.timedOut ? "timeout" : "unavailable";
+    }
+
+    // Format into a caller buffer of at least 64 bytes. Fixed two-decimal
+    // output for the table; shortest round-trip form for machine formats.
+    static char* formatNumber(char* first, double value, bool fixed)
+    {
+        char* last = first + 64;
+        auto result = fixed ? std::to_chars(first, last, value,
+                                            std::chars_format::fixed, 2)
+                            : std::to_chars(first, last, value);
+        if (result.ec != std::errc{})
+        {
+            // Too wide for fixed notation
+            result = std::to_chars(first, last, value);
+        }
+        return result.ptr;
+    }
+
+    void appendBytes(const void* data, size_t size)
+    {
+        buf_.append(static_cast<const char*>(data), size);
+    }
+
+    void appendPadded(std::string_view text, size_t width)
+    {
+        buf_.append(text);
+        if (text.size() < width)
+        {
+            buf_.append(width - text.size(), ' ');
+        }
+    }
+
+    void appendJsonString(std::string_view text)
+    {
+        buf_.push_back('"');
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                buf_.push_back('\\');
+                buf_.push_back(c);
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                constexpr char hex[] = "0123456789abcdef";
+                append("\\u00");
+                buf_.push_back(hex[(c >> 4) & 0xf]);
+                buf_.push_back(hex[c & 0xf]);
+            }
+            else
+            {
+                buf_.push_back(c);
+            }
+        }
+        buf_.push_back('"');
+    }
+
+    void appendCsvField(std::string_view text)
+    {
+        if (text.find_first_of(",\"\n") == std::string_view::npos)
+        {
+            buf_.append(text);
+            return;
+        }
+        buf_.push_back('"');
+        for (char c : text)
+        {
+            if (c == '"')
+            {
+                buf_.push_back('"');
+            }
+            buf_.push_back(c);
+        }
+        buf_.push_back('"');
+    }
+
+    void tableRow(const SensorInfo& info, const Reading& reading)
+    {
+        char value[96];
+        std::string_view valueText = reading.timedOut ? "N/A (timeout)"
+                                                      : "N/A";
+        if (reading.value)
+        {
+            // Format value with unit
+            char* p = formatNumber(value, *reading.value, true);
+            *p++ = ' ';
+            p = std::copy(info.unit.begin(), info.unit.end(), p);
+            valueText = {value, static_cast<size_t>(p - value)};
+        }
+
+        appendPadded(info.name, 30);
+        appendPadded(info.type, 12);
+        appendPadded(valueText, 15);
+        buf_.append(info.service);
+        buf_.push_back('\n');
+    }
+
+    void jsonRow(const SensorInfo& info, const Reading& reading)
+    {
+        append(rows_ == 0 ? "\n{\"name\":" : ",\n{\"name\":");
+        appendJsonString(info.name);
+        append(",\"type\":");
+        appendJsonString(info.type);
+        append(",\"value\":");
+        if (reading.value && std::isfinite(*reading.value))
+        {
+            char value[64];
+            buf_.append(value, formatNumber(value, *reading.value, false));
+        }
+        else
+        {
+            append("null"); // JSON has no NaN
+        }
+        append(",\"unit\":");
+        appendJsonString(info.unit);
+        append(",\"service\":");
+        appendJsonString(info.service);
+        append(",\"status\":\"");
+        append(statusName(reading));
+        append("\"}");
+    }
+
+    void csvRow(const SensorInfo& info, const Reading& reading)
+    {
+        appendCsvField(info.name);
+        buf_.push_back(',');
+        appendCsvField(info.type);
+        buf_.push_back(',');
+        if (reading.value && std::isfinite(*reading.value))
+        {
+            char value[64];
+            buf_.append(value, formatNumber(value, *reading.value, false));
+        }
+        buf_.push_back(',');
+        appendCsvField(info.unit);
+        buf_.push_back(',');
+        appendCsvField(info.service);
+        buf_.push_back(',');
+        append(statusName(reading));
+        buf_.push_back('\n');
+    }
+
+    void binRow(const SensorInfo& info, const Reading& reading)
+    {
+        const auto& name = info.name;
+        const auto& type = info.type;
+        const auto& unit = info.unit;
+        const auto& service = info.service;
+
+        using sensor_record::Status;
+        sensor_record::RecordHeader rec{};
+        rec.status = static_cast<uint8_t>(
+            reading.value ? Status::ok
+                          : (reading.timedOut ? Status::timeout
+                                              : Status::unavailable));
+        rec.value = reading.value.value_or(std::nan(""));
+        rec.nameLen = static_cast<uint16_t>(name.size());
+        rec.typeLen = static_cast<uint16_t>(type.size());
+        rec.unitLen = static_cast<uint16_t>(unit.size());
+        rec.serviceLen = static_cast<uint16_t>(service.size());
+
+        size_t unpadded = sizeof(rec) + name.size() + type.size() +
+                          unit.size() + service.size();
+        rec.length =
+            static_cast<uint32_t>(sensor_record::paddedLength(unpadded));
+
+        appendBytes(&rec, sizeof(rec));
+        buf_.append(name);
+        buf_.append(type);
+        buf_.append(unit);
+        buf_.append(service);
+        buf_.append(rec.length - unpadded, '\0');
+    }
+
+    OutputFormat format_;
+    std::string buf_;
+    size_t rows_ = 0;
+};
+
+/**
+ * Live sensor table driven by D-Bus signals.
+ *
+ * Three match rules cover the whole sensor tree regardless of how many
+ * sensors exist: PropertiesChanged for Sensor.Value under the search path,
+ * and InterfacesAdded/Removed whose object path lies under it. A value
+ * change rewrites a single terminal line in place; only hot-plug (a row
+ * appearing or disappearing) redraws the whole table. Rows are catalog
+ * entries, so a signal costs one hash lookup on its path.
+ *
+ * The matches are installed before the catalog and the values are read,
+ * and the table is drawn by hydrate() once the read is done. A signal
+ * handled in between is newer than the read, so its value (or removal)
+ * wins over the read's result for that sensor.
+ */
+class SensorWatch
+{
+  public:
+    SensorWatch(std::shared_ptr<sdbusplus::asio::connection> conn,
+                const std::string& searchPath, SensorCatalog& catalog,
+                const std::string& cacheDir) :
+        conn_(std::move(conn)), searchPath_(searchPath),
+        cacheDir_(cacheDir), catalog_(catalog)
+    {
+        namespace rules = sdbusplus::bus::match::rules;
+
+        valueMatch_ = std::make_unique<sdbusplus::bus::match_t>(
+            *conn_,
+            rules::type::signal() + rules::member("PropertiesChanged") +
+                rules::interface(propertiesInterface) +
+                rules::path_namespace(searchPath_) +
+                rules::argN(0, sensorValueInterface),
+            [this](sdbusplus::message_t& msg) { onValueChanged(msg); });
+
+        // InterfacesAdded/Removed come from the ObjectManager path, so the
+        // sensor path has to be matched on arg0 rather than the sender path
+        addedMatch_ = std::make_unique<sdbusplus::bus::match_t>(
+            *conn_,
+            rules::interfacesAdded() + rules::argNpath(0, searchPath_ + "/"),
+            [this](sdbusplus::message_t& msg) { onInterfacesAdded(msg); });
+
+        removedMatch_ = std::make_unique<sdbusplus::bus::match_t>(
+            *conn_,
+            rules::interfacesRemoved() + rules::argNpath(0, searchPath_ + "/"),
+            [this](sdbusplus::message_t& msg) { onInterfacesRemoved(msg); });
+
+        // A daemon that exits does not send InterfacesRemoved
+        ownerMatch_ = std::make_unique<sdbusplus::bus::match_t>(
+            *conn_, rules::nameOwnerChanged(),
+            [this](sdbusplus::message_t& msg) { onNameOwnerChanged(msg); });
+    }
+
+    // Merges the initial read (indexed like the catalog when the read
+    // started) with what signals have said since, and draws the table
+    void hydrate(SensorValues values)
+    {
+        grow();
+        for (uint32_t entry = 0; entry < catalog_.size(); ++entry)
+        {
+            if (seen_[entry] == Seen::nothing && entry < values.size())
+            {
+                readings_[entry] = values[entry];
+            }
+            // Sensor paths are unique per sensor; show only the first owner
+            if (seen_[entry] != Seen::removed &&
+                catalog_.find(catalog_.path(entry)) == entry)
+            {
+                order_.push_back(entry);
+            }
+        }
+        // Entries added by signals come after the mapper's, which are
+        // already in path order
+        std::sort(order_.begin(), order_.end(),
+                  [this](uint32_t lhs, uint32_t rhs) {
+                      return catalog_.path(lhs) < catalog_.path(rhs);
+                  });
+        hydrated_ = true;
+        seen_.clear();
+        redraw();
+    }
+
+    // Move the cursor below the table before the process exits
+    void finish()
+    {
+        moveTo(footerLine_ + 1);
+        out_.flush();
+    }
+
+  private:
+    // What signals said about an entry before hydrate()
+    enum class Seen : uint8_t
+    {
+        nothing,
+        value, // readings_ holds a value newer than the read
+        removed,
+    };
+
+    // Sizes the per-entry vectors to the catalog, which signals extend
+    void grow()
+    {
+        readings_.resize(catalog_.size());
+        lines_.resize(catalog_.size(), 0);
+        if (!hydrated_)
+        {
+            seen_.resize(catalog_.size(), Seen::nothing);
+        }
+    }
+
+    // Reads a signal's arguments; false if it is malformed, in which case
+    // it is ignored rather than ending the watch
+    template <typename... Args>
+    static bool readSignal(sdbusplus::message_t& msg, Args&... args)
+    {
+        try
+        {
+            msg.read(args...);
+            return true;
+        }
+        catch (const sdbusplus::exception::exception&)
+        {
+            return false;
+        }
+    }
+
+    // Entry for a path that signals should update, or npos: before
+    // hydrate() any catalog entry, afterwards only those on screen
+    uint32_t shownEntry(std::string_view path) const
+    {
+        auto entry = catalog_.find(path);
+        if (entry == SensorCatalog::npos ||
+            (hydrated_ && lines_[entry] == 0))
+        {
+            return SensorCatalog::npos;
+        }
+        return entry;
+    }
+
+    void onValueChanged(sdbusplus::message_t& msg)
+    {
+        std::string iface;
+        std::map<std::string, PropertyValue> changed;
+        if (!readSignal(msg, iface, changed))
+        {
+            return;
+        }
+
+        auto prop = changed.find("Value");
+        if (prop == changed.end())
+        {
+            return;
+        }
+        auto entry = shownEntry(msg.get_path());
+        if (entry == SensorCatalog::npos)
+        {
+            return;
+        }
+        if (const double* value = std::get_if<double>(&prop->second))
+        {
+            store(entry, Reading{*value});
+        }
+    }
+
+    // Records a reading newer than the initial read and shows it
+    void store(uint32_t entry, Reading reading)
+    {
+        grow();
+        if (!hydrated_)
+        {
+            if (seen_[entry] != Seen::removed)
+            {
+                readings_[entry] = reading;
+                seen_[entry] = Seen::value;
+            }
+            return;
+        }
+        readings_[entry] = reading;
+        if (lines_[entry] != 0)
+        {
+            drawRow(entry);
+        }
+    }
+
+    void onInterfacesAdded(sdbusplus::message_t& msg)
+    {
+        sdbusplus::message::object_path path;
+        std::map<std::string, std::map<std::string, PropertyValue>> ifaces;
+        if (!readSignal(msg, path, ifaces))
+        {
+            return;
+        }
+
+        // The signal already carries the initial property values
+        auto iface = ifaces.find(sensorValueInterface);
+        if (iface == ifaces.end())
+        {
+            return;
+        }
+        invalidateCache();
+
+        // The sender is a unique name; ask the mapper once for the
+        // well-known service so the Service column stays readable
+        auto entry = catalog_.find(path.str);
+        if (entry == SensorCatalog::npos)
+        {
+            entry = catalog_.add(path.str, msg.get_sender());
+        }
+        else
+        {
+            catalog_.setService(entry, msg.get_sender());
+        }
+        grow();
+
+        readings_[entry] = Reading{};
+        auto prop = iface->second.find("Value");
+        if (prop != iface->second.end())
+        {
+            if (const double* value = std::get_if<double>(&prop->second))
+            {
+                readings_[entry] = Reading{*value};
+            }
+        }
+        resolveService(entry);
+        if (!hydrated_)
+        {
+            // hydrate() adds the row
+            seen_[entry] = Seen::value;
+            return;
+        }
+
+        // Keep rows sorted by path
+        if (std::find(order_.begin(), order_.end(), entry) == order_.end())
+        {
+            auto pos = std::lower_bound(
+                order_.begin(), order_.end(), catalog_.path(entry),
+                [this](uint32_t lhs, std::string_view rhs) {
+                    return catalog_.path(lhs) < rhs;
+                });
+            order_.insert(pos, entry);
+        }
+        redraw();
+    }
+
+    void onInterfacesRemoved(sdbusplus::message_t& msg)
+    {
+        sdbusplus::message::object_path path;
+        std::vector<std::string> ifaces;
+        if (!readSignal(msg, path, ifaces))
+        {
+            return;
+        }
+
+        auto entry = shownEntry(path.str);
+        if (entry == SensorCatalog::npos ||
+            std::find(ifaces.begin(), ifaces.end(), sensorValueInterface) ==
+                ifaces.end())
+        {
+            return;
+        }
+
+        invalidateCache();
+        if (!hydrated_)
+        {
+            grow();
+            seen_[entry] = Seen::removed;
+            return;
+        }
+
+        // The catalog entry stays behind so a re-added sensor reuses it
+        order_.erase(std::find(order_.begin(), order_.end(), entry));
+        lines_[entry] = 0;
+        redraw();
+    }
+
+    void onNameOwnerChanged(sdbusplus::message_t& msg)
+    {
+        std::string name;
+        std::string oldOwner;
+        std::string newOwner;
+        if (!readSignal(msg, name, oldOwner, newOwner))
+        {
+            return;
+        }
+
+        // The old daemon's values no longer hold. A new owner (a restart
+        // or a replacement) has its own, so read them again.
+        bool known = false;
+        for (uint32_t entry = 0; entry < catalog_.size(); ++entry)
+        {
+            if (catalog_.service(entry) != name ||
+                shownEntry(catalog_.path(entry)) != entry)
+            {
+                continue;
+            }
+            known = true;
+            store(entry, Reading{});
+            if (!newOwner.empty())
+            {
+                readValue(entry);
+            }
+        }
+        if (known)
+        {
+            invalidateCache();
+        }
+    }
+
+    void readValue(uint32_t entry)
+    {
+        conn_->async_method_call(
+            [this, entry](const boost::system::error_code& ec,
+                          const std::variant<double>& value) {
+                // On error the row stays N/A; a sensor the new daemon
+                // has not created yet arrives with InterfacesAdded
+                if (!ec)
+                {
+                    store(entry, Reading{std::get<double>(value)});
+                }
+            },
+            std::string(catalog_.service(entry)),
+            std::string(catalog_.path(entry)), propertiesInterface, "Get",
+            sensorValueInterface, "Value");
+    }
+
+    // Tell later --cache runs that the mapper subtree has changed
+    void invalidateCache()
+    {
+        if (!cacheDir_.empty())
+        {
+            subtree_cache::bumpGeneration(cacheDir_);
+        }
+    }
+
+    void resolveService(uint32_t entry)
+    {
+        conn_->async_method_call(
+            [this, entry](const boost::system::error_code& ec,
+                          const std::map<std::string,
+                                         std::vector<std::string>>& owners) {
+                if (ec || owners.empty())
+                {
+                    return;
+                }
+                catalog_.setService(entry, owners.begin()->first);
+                if (lines_[entry] != 0)
+                {
+                    drawRow(entry);
+                }
+            },
+            objectMapperService, objectMapperPath, objectMapperInterface,
+            "GetObject", std::string(catalog_.path(entry)),
+            std::vector<std::string>{sensorValueInterface});
+    }
+
+    void moveTo(int line)
+    {
+        out_.append("\x1b[");
+        out_.appendUnsigned(line);
+        out_.append(";1H");
+    }
+
+    // Rewrite a single row in place, leaving the rest of the screen alone
+    void drawRow(uint32_t entry)
+    {
+        moveTo(lines_[entry]);
+        out_.append("\x1b[2K");
+        out_.row(catalog_.info(entry), readings_[entry]);
+        moveTo(footerLine_ + 1);
+        out_.flush();
+    }
+
+    void redraw()
+    {
+        // Clear screen, home cursor; header occupies lines 1-2
+        out_.append("\x1b[H\x1b[2J");
+        out_.header();
+
+        int line = 3;
+        for (auto entry : order_)
+        {
+            lines_[entry] = line++;
+            out_.row(catalog_.info(entry), readings_[entry]);
+        }
+        footerLine_ = line + 1;
+        out_.append("\nWatching ");
+        out_.appendUnsigned(order_.size());
+        out_.append(" sensors under ");
+        out_.append(searchPath_);
+        out_.append(" (Ctrl+C to exit)\n");
+        out_.flush();
+    }
+
+    std::shared_ptr<sdbusplus::asio::connection> conn_;
+    std::string searchPath_;
+    std::string cacheDir_; // empty: no subtree cache to invalidate
+    SensorCatalog& catalog_;
+
+    // Indexed by catalog entry; line 0 means the entry is not displayed
+    SensorValues readings_;
+    std::vector<int> lines_;
+    bool hydrated_ = false;
+    std::vector<Seen> seen_; // until hydrate()
+
+    // Displayed entries in path order
+    std::vector<uint32_t> order_;
+
+    SensorWriter out_{OutputFormat::table};
+    int footerLine_ = 0;
+
+    std::unique_ptr<sdbusplus::bus::match_t> valueMatch_;
+    std::unique_ptr<sdbusplus::bus::match_t> addedMatch_;
+    std::unique_ptr<sdbusplus::bus::match_t> removedMatch_;
+    std::unique_ptr<sdbusplus::bus::match_t> ownerMatch_;
+};
+
+// Value reading options shared by the one-shot and watch modes
+struct ReadOptions
+{
+    bool perSensor = false;
+    size_t jobs = 16;
+    std::chrono::milliseconds timeout{1000};
+};
+
+SensorValues readAllValues(sdbusplus::asio::connection& conn,
+                           const SensorCatalog& catalog,
+                           const ReadOptions& opts,
+                           ReadProfile* profile = nullptr)
+{
+    AsyncReader reader(conn, opts.jobs, opts.timeout);
+    return reader.readAll(catalog, opts.perSensor, profile);
+}
+
+// Subscribe, hydrate once, then update from signals until interrupted
+int runWatch(const std::string& searchPath, std::string_view filter,
+             const ReadOptions& opts, const std::string& cacheDir)
+{
+    boost::asio::io_context io;
+    auto conn = std::make_shared<sdbusplus::asio::connection>(io);
+
+    // Matches first, so a change made while the catalog and values are
+    // read is not lost; the signal is handled during or after the read
+    SensorCatalog catalog;
+    SensorWatch watch(conn, searchPath, catalog, cacheDir);
+    loadCatalog(*conn, catalog, searchPath, filter, cacheDir);
+    watch.hydrate(readAllValues(*conn, catalog, opts));
+
+    boost::asio::signal_set signals(io, SIGINT, SIGTERM);
+    signals.async_wait([&io](const boost::system::error_code&, int) {
+        io.stop();
+    });
+
+    io.run();
+    watch.finish();
+    return 0;
+}
+
+/**
+ * --profile: run the whole scan (mapper lookup plus all reads) `repeat`
+ * times and report latency percentiles instead of sensor values.
+ */
+int runProfile(const std::string& searchPath, std::string_view filter,
+               const ReadOptions& opts, const std::string& cacheDir,
+               size_t repeat, size_t slowest)
+{
+    boost::asio::io_context io;
+    auto conn = std::make_shared<sdbusplus::asio::connection>(io);
+
+    ReadProfile profile;
+    for (size_t scan = 0; scan < repeat; ++scan)
+    {
+        SensorCatalog catalog;
+        auto start = ReadProfile::Clock::now();
+        bool cached = loadCatalog(*conn, catalog, searchPath, filter,
+                                  cacheDir);
+        profile.recordMapper(ReadProfile::Clock::now() - start, cached);
+
+        readAllValues(*conn, catalog, opts, &profile);
+        profile.endScan();
+    }
+
+    profile.report(std::cout, slowest);
+    return 0;
+}
+
+// Value of an option that must be a positive integer. std::stoul alone
+// accepts "-1" (as a huge number) and ignores trailing text such as "8x".
+size_t positiveValue(const std::string& text)
+{
+    size_t used = 0;
+    auto value = std::stoul(text, &used);
+    if (used != text.size() || text.find('-') != std::string::npos ||
+        value == 0)
+    {
+        throw std::invalid_argument(text);
+    }
+    return value;
+}
+
+void printUsage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [TYPE] [OPTIONS]\n"
+              << "  TYPE                temperature, voltage, power, fan, "
+                 "... or all\n"
+              << "  --per-sensor        one Properties.Get per sensor\n"
+              << "  --watch             live table from PropertiesChanged\n"
+              << "  --jobs=N            reads in flight at once, N > 0\n"
+              << "  --timeout-ms=MS     timeout per read, MS > 0\n"
+              << "  --format=FORMAT     table, json, csv or bin\n"
+              << "  --cache[=DIR]       reuse the mapper subtree from DIR\n"
+              << "  --profile           latency report instead of values\n"
+              << "  --repeat=N          scans to profile\n"
+              << "  --slowest=N         slowest sensors to list\n";
+}
+
+int main(int argc, char* argv[])
+{
+    std::string filterType;
+    ReadOptions opts;
+    OutputFormat format = OutputFormat::table;
+    std::string cacheDir;
+    bool watch = false;
+    bool profile = false;
+    size_t repeat = 1;
+    size_t slowest = 10;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        try
+        {
+            if (arg == "--per-sensor")
+            {
+                opts.perSensor = true;
+            }
+            else if (arg == "--watch")
+            {
+                watch = true;
+            }
+            else if (arg == "--profile")
+            {
+                profile = true;
+            }
+            else if (arg.starts_with("--repeat="))
+            {
+                repeat = std::max<size_t>(std::stoul(arg.substr(9)), 1);
+            }
+            else if (arg.starts_with("--slowest="))
+            {
+                slowest = std::stoul(arg.substr(10));
+            }
+            else if (arg.starts_with("--format="))
+            {
+                auto name = arg.substr(9);
+                if (name == "table")
+                    format = OutputFormat::table;
+                else if (name == "json")
+                    format = OutputFormat::json;
+                else if (name == "csv")
+                    format = OutputFormat::csv;
+                else if (name == "bin")
+                    format = OutputFormat::bin;
+                else
+                {
+                    std::cerr << "Unknown format: " << name << "\n";
+                    return 1;
+                }
+            }
+            else if (arg == "--cache")
+            {
+                cacheDir = subtree_cache::defaultDir;
+            }
+            else if (arg.starts_with("--cache="))
+            {
+                cacheDir = arg.substr(8);
+            }
+            else if (arg.starts_with("--jobs="))
+            {
+                opts.jobs = positiveValue(arg.substr(7));
+            }
+            else if (arg.starts_with("--timeout-ms="))
+            {
+                // 0 would not mean "no time": sd-bus takes it as its
+                // default of 25 s
+                opts.timeout =
+                    std::chrono::milliseconds(positiveValue(arg.substr(13)));
+            }
+            else if (arg.starts_with("--"))
+            {
+                std::cerr << "Unknown option: " << arg << "\n";
+                return 1;
+            }
+            else
+            {
+                filterType = arg;
+            }
+        }
+        catch (const std::logic_error&) // from std::stoul, positiveValue
+        {
+            std::cerr << "Invalid value: " << arg << "\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Build search path
+    std::string searchPath = sensorBasePath;
+    if (!filterType.empty() && filterType != "all")
+    {
+        searchPath += "/" + filterType;
+    }
+
+    try
+    {
+        if (profile)
+        {
+            if (watch || format != OutputFormat::table)
+            {
+                std::cerr << "--profile cannot be combined with --watch "
+                             "or --format\n";
+                return 1;
+            }
+            return runProfile(searchPath, filterType, opts, cacheDir, repeat,
+                              slowest);
+        }
+
+        if (watch)
+        {
+            if (format != OutputFormat::table)
+            {
+                std::cerr << "--watch only supports the table format\n";
+                return 1;
+            }
+            return runWatch(searchPath, filterType, opts, cacheDir);
+        }
+
+        boost::asio::io_context io;
+        auto conn = std::make_shared<sdbusplus::asio::connection>(io);
+
+        // Use Object Mapper (or a still-valid --cache file) to find sensors
+        // and parse every path once
+        SensorCatalog catalog;
+        loadCatalog(*conn, catalog, searchPath, filterType, cacheDir);
+
+        if (catalog.size() == 0 && format == OutputFormat::table)
+        {
+            std::cout << "No sensors found";
+            if (!filterType.empty())
+            {
+                std::cout << " of type: " << filterType;
+            }
+            std::cout << "\n";
+            return 0;
+        }
+
+        // Fetch all values up front, then display in path order
+        auto values = readAllValues(*conn, catalog, opts);
+
+        SensorWriter out(format);
+        out.begin(catalog.size());
+        for (uint32_t entry = 0; entry < catalog.size(); ++entry)
+        {
+            out.row(catalog.info(entry), values[entry]);
+        }
+        out.end();
     }
     catch (const std::exception& e)
     {
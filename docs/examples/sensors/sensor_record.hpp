@@ -0,0 +1,137 @@
+/**
+ * Binary Sensor Snapshot Format
+ *
+ * Layout written by `sensor_reader --format=bin` and a reader for it.
+ *
+ * The stream is one FileHeader followed by `count` records. Every record
+ * starts with a RecordHeader whose `length` covers the header, the four
+ * strings (name, type, unit, service; not NUL-terminated) and padding up
+ * to an 8-byte boundary. A consumer can mmap a saved snapshot and hop from
+ * record to record without touching strings it does not need, and `value`
+ * is always 8-byte aligned. Integers and the double are in host byte order
+ * (little-endian on ASPEED and Nuvoton BMCs).
+ *
+ * Example consumer:
+ *   void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+ *   sensor_record::forEach(data, size, [](const sensor_record::View& v) {
+ *       std::printf("%.*s %f\n", int(v.name.size()), v.name.data(), v.value);
+ *   });
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace sensor_record
+{
+
+constexpr uint32_t magic = 0x42445253; // "SRDB" in little-endian
+constexpr uint16_t version = 1;
+constexpr size_t alignment = 8;
+
+struct FileHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize; // sizeof(FileHeader), lets readers skip extensions
+    uint32_t count;      // number of records that follow
+    uint32_t reserved;
+};
+static_assert(sizeof(FileHeader) == 16);
+
+enum class Status : uint8_t
+{
+    ok = 0,
+    unavailable = 1,
+    timeout = 2
+};
+
+struct RecordHeader
+{
+    uint32_t length; // whole record including strings and padding
+    uint8_t status;  // Status
+    uint8_t reserved0;
+    uint16_t nameLen;
+    double value; // NaN unless status == ok
+    uint16_t typeLen;
+    uint16_t unitLen;
+    uint16_t serviceLen;
+    uint16_t reserved1;
+};
+static_assert(sizeof(RecordHeader) == 24);
+
+constexpr size_t paddedLength(size_t length)
+{
+    return (length + alignment - 1) & ~(alignment - 1);
+}
+
+// Decoded record; the string_views point into the mapped buffer
+struct View
+{
+    Status status;
+    double value;
+    std::string_view name;
+    std::string_view type;
+    std::string_view unit;
+    std::string_view service;
+};
+
+/**
+ * Walk every record in a snapshot buffer.
+ *
+ * Returns false if the buffer is not a valid snapshot or a record runs
+ * past the end; records before the bad one have already been delivered.
+ */
+template <typename Callback>
+bool forEach(const void* data, size_t size, Callback&& callback)
+{
+    const auto* base = static_cast<const char*>(data);
+    FileHeader file{};
+    if (size < sizeof(file))
+    {
+        return false;
+    }
+    std::memcpy(&file, base, sizeof(file));
+    if (file.magic != magic || file.version != version ||
+        file.headerSize < sizeof(file) || file.headerSize > size)
+    {
+        return false;
+    }
+
+    size_t offset = file.headerSize;
+    for (uint32_t i = 0; i < file.count; ++i)
+    {
+        RecordHeader rec{};
+        if (size - offset < sizeof(rec))
+        {
+            return false;
+        }
+        std::memcpy(&rec, base + offset, sizeof(rec));
+
+        size_t strings = size_t{rec.nameLen} + rec.typeLen + rec.unitLen +
+                         rec.serviceLen;
+        if (rec.length < sizeof(rec) + strings || rec.length > size - offset)
+        {
+            return false;
+        }
+
+        const char* p = base + offset + sizeof(rec);
+        View view{static_cast<Status>(rec.status), rec.value, {}, {}, {}, {}};
+        view.name = {p, rec.nameLen};
+        p += rec.nameLen;
+        view.type = {p, rec.typeLen};
+        p += rec.typeLen;
+        view.unit = {p, rec.unitLen};
+        p += rec.unitLen;
+        view.service = {p, rec.serviceLen};
+
+        callback(view);
+        offset += rec.length;
+    }
+    return true;
+}
+
+} // namespace sensor_record
@@ -0,0 +1,347 @@
+/**
+ * ObjectMapper Subtree Cache
+ *
+ * Persists the sensor catalog (path -> service) resolved from the Object
+ * Mapper so later `sensor_reader --cache` runs can skip GetSubTree, one of
+ * the most expensive mapper calls on a loaded BMC.
+ *
+ * File layout (host byte order, read in place through mmap):
+ *
+ *   CacheHeader
+ *   ServiceRecord[serviceCount]   well-known name and its unique owner
+ *   EntryRecord[entryCount]       object path and index of its service
+ *   char strings[stringBytes]     all names, not NUL-terminated
+ *
+ * The interface list of each entry is not stored: the subtree query is
+ * filtered on xyz.openbmc_project.Sensor.Value, so it is always that one.
+ *
+ * A cache file is only trusted when:
+ *   - its generation matches the stamp in `<dir>/generation`, which any
+ *     `sensor_reader --watch --cache` bumps on InterfacesAdded/Removed and
+ *     NameOwnerChanged, and
+ *   - every service is still owned by the same unique bus name, which the
+ *     caller checks with GetNameOwner (catches daemon restarts even when
+ *     no watcher is running).
+ *
+ * Files are written to a temporary name and renamed into place, so a
+ * reader never maps a half-written cache.
+ */
+
+#pragma once
+
+#include "sensor_catalog.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace subtree_cache
+{
+
+constexpr uint32_t magic = 0x43535253; // "SRSC" in little-endian
+constexpr uint16_t version = 1;
+constexpr auto defaultDir = "/run/sensor_reader";
+
+struct CacheHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint64_t generation;
+    uint32_t serviceCount;
+    uint32_t entryCount;
+    uint32_t stringBytes;
+    uint32_t reserved;
+};
+static_assert(sizeof(CacheHeader) == 32);
+
+struct ServiceRecord
+{
+    uint32_t nameOffset;
+    uint32_t nameLen;
+    uint32_t ownerOffset; // unique name (":1.42") when the cache was built
+    uint32_t ownerLen;
+};
+
+struct EntryRecord
+{
+    uint32_t pathOffset;
+    uint32_t pathLen;
+    uint32_t service; // index into the ServiceRecord array
+    uint32_t reserved;
+};
+
+inline std::string generationFile(const std::string& dir)
+{
+    return dir + "/generation";
+}
+
+// One cache file per search filter, e.g. subtree-temperature.bin
+inline std::string cacheFile(const std::string& dir, std::string_view filter)
+{
+    std::string name = "subtree-";
+    if (filter.empty())
+    {
+        name += "all";
+    }
+    for (char c : filter)
+    {
+        bool safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                    (c >= '0' && c <= '9') || c == '_';
+        name.push_back(safe ? c : '_');
+    }
+    return dir + "/" + name + ".bin";
+}
+
+// Current generation stamp, 0 if no watcher has ever written one
+inline uint64_t readGeneration(const std::string& dir)
+{
+    uint64_t generation = 0;
+    std::ifstream in(generationFile(dir), std::ios::binary);
+    in.read(reinterpret_cast<char*>(&generation), sizeof(generation));
+    return in ? generation : 0;
+}
+
+// Write `data` to `file` atomically (temporary file + rename)
+inline bool writeAtomic(const std::string& file, const std::string& data)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(
+        std::filesystem::path(file).parent_path(), ec);
+
+    std::string tmp = file + ".tmp." + std::to_string(getpid());
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!out)
+        {
+            std::filesystem::remove(tmp, ec);
+            return false;
+        }
+    }
+    return std::rename(tmp.c_str(), file.c_str()) == 0;
+}
+
+/**
+ * Invalidate every cache file in `dir`.
+ *
+ * The stamp is a wall-clock timestamp rather than a counter, so two
+ * watchers bumping at once still leave a value no cache was built with.
+ */
+inline void bumpGeneration(const std::string& dir)
+{
+    uint64_t stamp = static_cast<uint64_t>(
+        std::chrono::system_clock::now().time_since_epoch().count());
+    writeAtomic(generationFile(dir),
+                std::string(reinterpret_cast<const char*>(&stamp),
+                            sizeof(stamp)));
+}
+
+/**
+ * Serialize a catalog. `owners` maps each service in the catalog to the
+ * unique name that owned it when the subtree was resolved.
+ */
+inline bool save(const std::string& file, uint64_t generation,
+                 const SensorCatalog& catalog,
+                 const std::map<std::string, std::string>& owners)
+{
+    std::string strings;
+    auto addString = [&strings](std::string_view text) {
+        auto offset = static_cast<uint32_t>(strings.size());
+        strings.append(text);
+        return offset;
+    };
+
+    std::vector<ServiceRecord> services;
+    std::map<std::string_view, uint32_t> serviceIndex;
+    for (const auto& [name, owner] : owners)
+    {
+        serviceIndex[name] = static_cast<uint32_t>(services.size());
+        services.push_back(ServiceRecord{
+            addString(name), static_cast<uint32_t>(name.size()),
+            addString(owner), static_cast<uint32_t>(owner.size())});
+    }
+
+    std::vector<EntryRecord> entries;
+    entries.reserve(catalog.size());
+    for (uint32_t entry = 0; entry < catalog.size(); ++entry)
+    {
+        auto service = serviceIndex.find(catalog.service(entry));
+        if (service == serviceIndex.end())
+        {
+            return false; // caller did not resolve every owner
+        }
+        auto path = catalog.path(entry);
+        entries.push_back(EntryRecord{addString(path),
+                                      static_cast<uint32_t>(path.size()),
+                                      service->second, 0});
+    }
+
+    CacheHeader header{};
+    header.magic = magic;
+    header.version = version;
+    header.headerSize = sizeof(header);
+    header.generation = generation;
+    header.serviceCount = static_cast<uint32_t>(services.size());
+    header.entryCount = static_cast<uint32_t>(entries.size());
+    header.stringBytes = static_cast<uint32_t>(strings.size());
+
+    std::string data;
+    data.reserve(sizeof(header) + services.size() * sizeof(ServiceRecord) +
+                 entries.size() * sizeof(EntryRecord) + strings.size());
+    data.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    data.append(reinterpret_cast<const char*>(services.data()),
+                services.size() * sizeof(ServiceRecord));
+    data.append(reinterpret_cast<const char*>(entries.data()),
+                entries.size() * sizeof(EntryRecord));
+    data.append(strings);
+    return writeAtomic(file, data);
+}
+
+/**
+ * Read-only mapping of a cache file. All string_views returned point into
+ * the mapping and are valid while the Snapshot lives.
+ */
+class Snapshot
+{
+  public:
+    Snapshot() = default;
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+    ~Snapshot()
+    {
+        if (data_ != nullptr)
+        {
+            munmap(const_cast<char*>(data_), size_);
+        }
+    }
+
+    // Map and validate `file`; false if missing, truncated or foreign
+    bool load(const std::string& file)
+    {
+        int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat st{};
+        void* addr = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && st.st_size >= 0 &&
+            static_cast<size_t>(st.st_size) >= sizeof(CacheHeader))
+        {
+            size_ = static_cast<size_t>(st.st_size);
+            addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+        if (addr == MAP_FAILED)
+        {
+            return false;
+        }
+        data_ = static_cast<const char*>(addr);
+
+        std::memcpy(&header_, data_, sizeof(header_));
+        size_t needed = size_t{header_.headerSize} +
+                        size_t{header_.serviceCount} * sizeof(ServiceRecord) +
+                        size_t{header_.entryCount} * sizeof(EntryRecord) +
+                        header_.stringBytes;
+        return header_.magic == magic && header_.version == version &&
+               header_.headerSize >= sizeof(CacheHeader) && needed <= size_;
+    }
+
+    uint64_t generation() const
+    {
+        return header_.generation;
+    }
+
+    size_t serviceCount() const
+    {
+        return header_.serviceCount;
+    }
+
+    std::string_view serviceName(size_t index) const
+    {
+        auto rec = service(index);
+        return string(rec.nameOffset, rec.nameLen);
+    }
+
+    std::string_view serviceOwner(size_t index) const
+    {
+        auto rec = service(index);
+        return string(rec.ownerOffset, rec.ownerLen);
+    }
+
+    // Rebuild the catalog from the cached entries; false if corrupt
+    bool fill(SensorCatalog& catalog) const
+    {
+        const char* base = entriesBase();
+        for (uint32_t i = 0; i < header_.entryCount; ++i)
+        {
+            EntryRecord rec{};
+            std::memcpy(&rec, base + i * sizeof(rec), sizeof(rec));
+            if (rec.service >= header_.serviceCount ||
+                !inStrings(rec.pathOffset, rec.pathLen))
+            {
+                return false;
+            }
+            catalog.add(string(rec.pathOffset, rec.pathLen),
+                        serviceName(rec.service));
+        }
+        return true;
+    }
+
+  private:
+    const char* servicesBase() const
+    {
+        return data_ + header_.headerSize;
+    }
+
+    const char* entriesBase() const
+    {
+        return servicesBase() + header_.serviceCount * sizeof(ServiceRecord);
+    }
+
+    const char* stringsBase() const
+    {
+        return entriesBase() + header_.entryCount * sizeof(EntryRecord);
+    }
+
+    bool inStrings(uint32_t offset, uint32_t length) const
+    {
+        return size_t{offset} + length <= header_.stringBytes;
+    }
+
+    ServiceRecord service(size_t index) const
+    {
+        ServiceRecord rec{};
+        std::memcpy(&rec, servicesBase() + index * sizeof(rec), sizeof(rec));
+        if (!inStrings(rec.nameOffset, rec.nameLen) ||
+            !inStrings(rec.ownerOffset, rec.ownerLen))
+        {
+            return ServiceRecord{};
+        }
+        return rec;
+    }
+
+    std::string_view string(uint32_t offset, uint32_t length) const
+    {
+        return {stringsBase() + offset, length};
+    }
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    CacheHeader header_{};
+};
+
+} // namespace subtree_cache
@@ -0,0 +1,475 @@
+/**
+ * Virtual Sensor Expressions
+ *
+ * Arithmetic over named sensor inputs, e.g. `(a + b) / c`,
+ * `max(inlet, outlet) - min(inlet, outlet)` or `sum(psu0, psu1)`.
+ *
+ * An expression is parsed once, when the configuration is loaded, into a
+ * flat postfix program for a small stack machine. Variables are resolved
+ * to input slots at compile time, and the deepest stack the program can
+ * reach is computed then too. Evaluation is therefore a single pass over
+ * a contiguous instruction array with a fixed-size stack on the C++
+ * stack: no allocation, no name lookup, no recursion.
+ *
+ * Grammar:
+ *   expr    := term (('+' | '-') term)*
+ *   term    := unary (('*' | '/') unary)*
+ *   unary   := '-' unary | primary
+ *   primary := number | name | name '(' expr (',' expr)* ')' | '(' expr ')'
+ *   name    := [A-Za-z_][A-Za-z0-9_.]*
+ *
+ * Functions: min, max, sum, avg (one or more arguments) and abs.
+ *
+ * An unavailable input is NaN. Operators propagate NaN, so `a - b` is
+ * unavailable if either side is. The aggregate functions skip NaN
+ * arguments and only return NaN when every argument is, so `sum(psu0,
+ * psu1)` keeps reporting while one PSU is out.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace expression
+{
+
+enum class Op : uint8_t
+{
+    input,    // push inputs[operand]
+    constant, // push constants[operand]
+    add,
+    sub,
+    mul,
+    div,
+    neg,
+    abs,
+    min, // operand: argument count
+    max,
+    sum,
+    avg
+};
+
+struct Instruction
+{
+    Op op;
+    uint32_t operand;
+};
+
+// Deepest stack a program may need; deeper expressions fail to compile
+constexpr size_t maxStackDepth = 32;
+
+class Program
+{
+  public:
+    /**
+     * Run the program over `inputs`, indexed by the slots the resolver
+     * returned at compile time.
+     */
+    double evaluate(std::span<const double> inputs) const
+    {
+        std::array<double, maxStackDepth> stack;
+        size_t top = 0; // number of values on the stack
+
+        for (const auto& ins : code_)
+        {
+            switch (ins.op)
+            {
+                case Op::input:
+                    stack[top++] = inputs[ins.operand];
+                    break;
+                case Op::constant:
+                    stack[top++] = constants_[ins.operand];
+                    break;
+                case Op::add:
+                    --top;
+                    stack[top - 1] += stack[top];
+                    break;
+                case Op::sub:
+                    --top;
+                    stack[top - 1] -= stack[top];
+                    break;
+                case Op::mul:
+                    --top;
+                    stack[top - 1] *= stack[top];
+                    break;
+                case Op::div:
+                    --top;
+                    stack[top - 1] /= stack[top];
+                    break;
+                case Op::neg:
+                    stack[top - 1] = -stack[top - 1];
+                    break;
+                case Op::abs:
+                    stack[top - 1] = std::fabs(stack[top - 1]);
+                    break;
+                case Op::min:
+                case Op::max:
+                case Op::sum:
+                case Op::avg:
+                    top -= ins.operand;
+                    stack[top] = aggregate(ins, &stack[top]);
+                    ++top;
+                    break;
+            }
+        }
+        return stack[0];
+    }
+
+    // Input slots referenced by the program, each listed once
+    const std::vector<uint32_t>& inputs() const
+    {
+        return inputs_;
+    }
+
+    size_t size() const
+    {
+        return code_.size();
+    }
+
+  private:
+    friend class Compiler;
+
+    static double aggregate(const Instruction& ins, const double* args)
+    {
+        double result = std::numeric_limits<double>::quiet_NaN();
+        uint32_t valid = 0;
+        for (uint32_t i = 0; i < ins.operand; ++i)
+        {
+            double v = args[i];
+            if (std::isnan(v))
+            {
+                continue;
+            }
+            if (valid++ == 0)
+            {
+                result = v;
+            }
+            else if (ins.op == Op::min)
+            {
+                result = std::min(result, v);
+            }
+            else if (ins.op == Op::max)
+            {
+                result = std::max(result, v);
+            }
+            else
+            {
+                result += v;
+            }
+        }
+        if (ins.op == Op::avg && valid > 0)
+        {
+            result /= valid;
+        }
+        return result;
+    }
+
+    std::vector<Instruction> code_;
+    std::vector<double> constants_;
+    std::vector<uint32_t> inputs_;
+};
+
+// Thrown for syntax errors, unknown names and over-deep expressions
+class CompileError : public std::invalid_argument
+{
+  public:
+    CompileError(const std::string& what, size_t position) :
+        std::invalid_argument(what + " at offset " + std::to_string(position)),
+        position_(position)
+    {}
+
+    size_t position() const
+    {
+        return position_;
+    }
+
+  private:
+    size_t position_;
+};
+
+// Maps a variable name to an input slot; throws or returns npos if unknown
+using Resolver = std::function<uint32_t(std::string_view name)>;
+constexpr uint32_t npos = UINT32_MAX;
+
+/**
+ * Recursive descent parser that emits postfix code as it goes. Only used
+ * at startup; see compile().
+ */
+class Compiler
+{
+  public:
+    Compiler(std::string_view text, const Resolver& resolve) :
+        text_(text), resolve_(resolve)
+    {}
+
+    Program run()
+    {
+        parseExpr();
+        skipSpace();
+        if (pos_ != text_.size())
+        {
+            throw CompileError("unexpected '" + std::string(1, text_[pos_]) +
+                                   "'",
+                               pos_);
+        }
+        return std::move(program_);
+    }
+
+  private:
+    void parseExpr()
+    {
+        parseTerm();
+        while (true)
+        {
+            if (accept('+'))
+            {
+                parseTerm();
+                emit(Op::add, 0, -1);
+            }
+            else if (accept('-'))
+            {
+                parseTerm();
+                emit(Op::sub, 0, -1);
+            }
+            else
+            {
+                return;
+            }
+        }
+    }
+
+    void parseTerm()
+    {
+        parseUnary();
+        while (true)
+        {
+            if (accept('*'))
+            {
+                parseUnary();
+                emit(Op::mul, 0, -1);
+            }
+            else if (accept('/'))
+            {
+                parseUnary();
+                emit(Op::div, 0, -1);
+            }
+            else
+            {
+                return;
+            }
+        }
+    }
+
+    void parseUnary()
+    {
+        if (accept('-'))
+        {
+            parseUnary();
+            emit(Op::neg, 0, 0);
+            return;
+        }
+        parsePrimary();
+    }
+
+    void parsePrimary()
+    {
+        skipSpace();
+        size_t start = pos_;
+        if (accept('('))
+        {
+            parseExpr();
+            expect(')');
+            return;
+        }
+        if (pos_ < text_.size() && (isDigit(text_[pos_]) || text_[pos_] == '.'))
+        {
+            parseNumber();
+            return;
+        }
+        if (pos_ < text_.size() && isNameStart(text_[pos_]))
+        {
+            while (pos_ < text_.size() && isNameChar(text_[pos_]))
+            {
+                ++pos_;
+            }
+            auto name = text_.substr(start, pos_ - start);
+            if (accept('('))
+            {
+                parseCall(name, start);
+                return;
+            }
+            uint32_t slot = resolve_(name);
+            if (slot == npos)
+            {
+                throw CompileError("unknown input '" + std::string(name) + "'",
+                                   start);
+            }
+            addInput(slot);
+            emit(Op::input, slot, 1);
+            return;
+        }
+        throw CompileError(pos_ < text_.size() ? "expected a value"
+                                               : "unexpected end",
+                           pos_);
+    }
+
+    void parseNumber()
+    {
+        size_t start = pos_;
+        std::string digits;
+        while (pos_ < text_.size() &&
+               (isDigit(text_[pos_]) || text_[pos_] == '.' ||
+                text_[pos_] == 'e' || text_[pos_] == 'E' ||
+                ((text_[pos_] == '+' || text_[pos_] == '-') &&
+                 (text_[pos_ - 1] == 'e' || text_[pos_ - 1] == 'E'))))
+        {
+            digits.push_back(text_[pos_++]);
+        }
+        size_t used = 0;
+        double value = 0.0;
+        try
+        {
+            value = std::stod(digits, &used);
+        }
+        catch (const std::exception&)
+        {}
+        if (used != digits.size())
+        {
+            throw CompileError("bad number '" + digits + "'", start);
+        }
+        auto index = static_cast<uint32_t>(program_.constants_.size());
+        program_.constants_.push_back(value);
+        emit(Op::constant, index, 1);
+    }
+
+    void parseCall(std::string_view name, size_t start)
+    {
+        Op op;
+        if (name == "min")
+            op = Op::min;
+        else if (name == "max")
+            op = Op::max;
+        else if (name == "sum")
+            op = Op::sum;
+        else if (name == "avg")
+            op = Op::avg;
+        else if (name == "abs")
+            op = Op::abs;
+        else
+            throw CompileError("unknown function '" + std::string(name) + "'",
+                               start);
+
+        uint32_t argc = 0;
+        do
+        {
+            parseExpr();
+            ++argc;
+        } while (accept(','));
+        expect(')');
+
+        if (op == Op::abs)
+        {
+            if (argc != 1)
+            {
+                throw CompileError("abs takes one argument", start);
+            }
+            emit(Op::abs, 0, 0);
+            return;
+        }
+        emit(op, argc, 1 - static_cast<int>(argc));
+    }
+
+    // Append one instruction; `effect` is its net change to the stack
+    void emit(Op op, uint32_t operand, int effect)
+    {
+        program_.code_.push_back(Instruction{op, operand});
+        depth_ += effect;
+        if (static_cast<size_t>(depth_) > maxStackDepth)
+        {
+            throw CompileError("expression nests too deeply", pos_);
+        }
+    }
+
+    void addInput(uint32_t slot)
+    {
+        for (auto existing : program_.inputs_)
+        {
+            if (existing == slot)
+            {
+                return;
+            }
+        }
+        program_.inputs_.push_back(slot);
+    }
+
+    void skipSpace()
+    {
+        while (pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\t'))
+        {
+            ++pos_;
+        }
+    }
+
+    bool accept(char c)
+    {
+        skipSpace();
+        if (pos_ < text_.size() && text_[pos_] == c)
+        {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c)
+    {
+        if (!accept(c))
+        {
+            throw CompileError(std::string("expected '") + c + "'", pos_);
+        }
+    }
+
+    static bool isDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    static bool isNameStart(char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+    }
+
+    // '.' lets the resolver offer derived values such as `psu0.ewma`
+    static bool isNameChar(char c)
+    {
+        return isNameStart(c) || isDigit(c) || c == '.';
+    }
+
+    std::string_view text_;
+    const Resolver& resolve_;
+    size_t pos_ = 0;
+    int depth_ = 0;
+    Program program_;
+};
+
+/**
+ * Compile `text`, asking `resolve` for the slot of every variable.
+ * Throws CompileError on any problem.
+ */
+inline Program compile(std::string_view text, const Resolver& resolve)
+{
+    return Compiler(text, resolve).run();
+}
+
+} // namespace expression
@@ -0,0 +1,108 @@
+/**
+ * Virtual Sensor Memory Benchmark
+ *
+ * Measures resident memory per hosted virtual sensor. Sensors are added
+ * to one VirtualSensorManager in steps up to 5,000, and VmRSS is printed
+ * after each step. The last column compares that with running one
+ * single-sensor process per sensor, using this process's RSS at one
+ * sensor as the per-process cost.
+ *
+ * Sensors are synthetic: `sum(a, b)` over a pool of 256 input paths, so
+ * inputs are shared the way real rails and temperatures are, and every
+ * fourth sensor polls its inputs every 5 s on the timer wheel. The input
+ * services do not exist, so the initial Gets fail fast and the numbers
+ * are the host's own cost.
+ *
+ * Usage (needs a bus; the container entrypoint provides one):
+ *   ./virtual_sensor_rss_bench
+ *   ./run.sh ./builddir/virtual_sensor_rss_bench
+ */
+
+#include <sdbusplus/asio/connection.hpp>
+#include <boost/asio/io_context.hpp>
+#include "virtual_sensor.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+
+// Resident set size of this process in KiB
+long residentKiB()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.starts_with("VmRSS:"))
+        {
+            return std::stol(line.substr(6));
+        }
+    }
+    return 0;
+}
+
+virtual_sensor::SensorConfig benchSensor(size_t index)
+{
+    constexpr size_t inputPool = 256;
+    auto inputPath = [](size_t n) {
+        return "/xyz/openbmc_project/sensors/power/Bench_Input_" +
+               std::to_string(n % inputPool);
+    };
+
+    virtual_sensor::SensorConfig config;
+    config.name = "Bench_" + std::to_string(index);
+    config.type = "power";
+    config.unit = "Watts";
+    config.expression = "sum(a, b)";
+    config.inputs = {
+        {"a", "xyz.openbmc_project.BenchSensor", inputPath(index)},
+        {"b", "xyz.openbmc_project.BenchSensor", inputPath(index * 7 + 1)},
+    };
+    if (index % 4 == 0)
+    {
+        config.pollInterval = std::chrono::seconds(5);
+    }
+    return config;
+}
+
+int main()
+{
+    boost::asio::io_context io;
+    auto conn = std::make_shared<sdbusplus::asio::connection>(io);
+    VirtualSensorManager manager(conn);
+
+    // Let the failed initial Gets complete so their buffers are released
+    auto settle = [&io]() {
+        io.restart();
+        io.run_for(std::chrono::milliseconds(200));
+    };
+
+    settle();
+    long baseline = residentKiB();
+    long single = 0;
+
+    std::printf("%8s %7s %7s %10s %11s %16s\n", "sensors", "inputs",
+                "polled", "RSS (KiB)", "KiB/sensor", "1 proc/sensor");
+    for (size_t target : {1, 10, 100, 500, 1000, 2000, 5000})
+    {
+        while (manager.sensorCount() < target)
+        {
+            manager.add(benchSensor(manager.sensorCount()));
+        }
+        settle();
+
+        long rss = residentKiB();
+        if (target == 1)
+        {
+            single = rss;
+        }
+        double perSensor = static_cast<double>(rss - baseline) /
+                           static_cast<double>(target);
+        std::printf("%8zu %7zu %7zu %10ld %11.2f %16ld\n", target,
+                    manager.inputCount(), manager.polledCount(), rss,
+                    perSensor, single * static_cast<long>(target));
+    }
+    return 0;
+}
@@ -0,0 +1,281 @@
+/**
+ * Virtual Sensor Configuration
+ *
+ * Loads the list of virtual sensors to host from a JSON file, e.g.:
+ *
+ *   {
+ *     "sensors": [
+ *       {
+ *         "name": "Total_Power",
+ *         "type": "power",
+ *         "unit": "Watts",
+ *         "expression": "sum(psu0, psu1)",
+ *         "min": 0, "max": 10000,
+ *         "poll_ms": 0,
+ *         "window_ms": 60000, "ewma_ms": 10000,
+ *         "deadband": 5, "deadband_percent": 0,
+ *         "min_interval_ms": 1000, "heartbeat_ms": 30000,
+ *         "read_timeout_ms": 1000, "stale_ms": 0, "stale_policy": "exclude",
+ *         "thresholds": { "warning_high": 8000, "critical_high": 9500,
+ *                         "hysteresis": 100 },
+ *         "inputs": {
+ *           "psu0": { "service": "xyz.openbmc_project.PSUSensor",
+ *                     "path": "/xyz/openbmc_project/sensors/power/PSU0_Output_Power" },
+ *           "psu1": { "service": "xyz.openbmc_project.PSUSensor",
+ *                     "path": "/xyz/openbmc_project/sensors/power/PSU1_Output_Power",
+ *                     "stale_ms": 5000 }
+ *         }
+ *       }
+ *     ]
+ *   }
+ *
+ * The sensor is published at /xyz/openbmc_project/sensors/<type>/<name>,
+ * and `unit` is the last element of a Sensor.Value.Unit enum value.
+ * Inputs are followed through PropertiesChanged; `poll_ms` (optional)
+ * additionally re-reads them periodically, for services that do not emit
+ * signals. `window_ms` and `ewma_ms` (optional) size the rolling window
+ * and EWMA time constant behind `<input>.<stat>` variables such as
+ * `psu0.ewma`. See expression.hpp for the expression syntax.
+ *
+ * The remaining keys (all optional, 0 disables) limit how often the Value
+ * PropertiesChanged signal is sent. A change is signalled only once it
+ * reaches `deadband` (absolute) and `deadband_percent` (of the last
+ * signalled value), and no sooner than `min_interval_ms` after the
+ * previous signal; a change held back by the interval goes out when it
+ * ends. `heartbeat_ms` re-signals the current value if nothing was sent
+ * for that long, so subscribers also see changes inside the deadband.
+ *
+ * An input is stale while it has no value, after a read of it failed or
+ * took longer than `read_timeout_ms`, and while its service has no owner
+ * on the bus. `read_timeout_ms` must be greater than 0: sd-bus would take
+ * 0 as its own 25 s default, not as "no timeout". With `stale_ms` (per sensor, or per input to override), an
+ * input that has not changed for that long is read again and goes stale
+ * if that read fails. `stale_policy` is what the sensor does with a stale
+ * input:
+ *   - "exclude" (default): treat it as unavailable (NaN), so aggregates
+ *     skip it and operators give NaN;
+ *   - "hold": keep using its last value;
+ *   - "nonfunctional": keep using its last value, but set
+ *     OperationalStatus.Functional to false until every input is fresh.
+ *
+ * `thresholds` (optional) adds the Sensor.Threshold.Warning and/or
+ * .Critical interfaces for whichever of warning_high, warning_low,
+ * critical_high and critical_low are given; see threshold.hpp.
+ * virtual_sensors.json next to this file is a fuller example.
+ */
+
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace virtual_sensor
+{
+
+struct InputConfig
+{
+    std::string name; // variable name used in the expression
+    std::string service;
+    std::string path;
+    std::chrono::milliseconds staleAfter{0}; // 0: only when unreachable
+};
+
+enum class StalePolicy
+{
+    exclude,
+    hold,
+    nonfunctional
+};
+
+// When to send PropertiesChanged for a sensor's Value; zero disables
+struct EmitPolicy
+{
+    double deadband = 0.0;
+    double deadbandPercent = 0.0;
+    std::chrono::milliseconds minInterval{0};
+    std::chrono::milliseconds heartbeat{0};
+
+    bool timed() const
+    {
+        return minInterval.count() > 0 || heartbeat.count() > 0;
+    }
+};
+
+// Threshold limits; NaN: not set
+struct ThresholdConfig
+{
+    double warningHigh = std::numeric_limits<double>::quiet_NaN();
+    double warningLow = std::numeric_limits<double>::quiet_NaN();
+    double criticalHigh = std::numeric_limits<double>::quiet_NaN();
+    double criticalLow = std::numeric_limits<double>::quiet_NaN();
+    double hysteresis = 0.0;
+
+    bool warning() const
+    {
+        return !std::isnan(warningHigh) || !std::isnan(warningLow);
+    }
+
+    bool critical() const
+    {
+        return !std::isnan(criticalHigh) || !std::isnan(criticalLow);
+    }
+};
+
+struct SensorConfig
+{
+    std::string name;
+    std::string type;
+    std::string unit;
+    std::string expression;
+    double minValue = std::numeric_limits<double>::quiet_NaN();
+    double maxValue = std::numeric_limits<double>::quiet_NaN();
+    std::chrono::milliseconds pollInterval{0}; // 0: signals only
+    std::chrono::milliseconds window{60000};   // for <input>.<stat>
+    std::chrono::milliseconds ewmaTau{10000};
+    EmitPolicy emit;
+    std::chrono::milliseconds readTimeout{1000};
+    StalePolicy stalePolicy = StalePolicy::exclude;
+    ThresholdConfig thresholds;
+    std::vector<InputConfig> inputs;
+
+    std::string objectPath() const
+    {
+        return "/xyz/openbmc_project/sensors/" + type + "/" + name;
+    }
+
+    std::string unitValue() const
+    {
+        return "xyz.openbmc_project.Sensor.Value.Unit." + unit;
+    }
+};
+
+inline StalePolicy parseStalePolicy(const std::string& name)
+{
+    if (name == "exclude")
+    {
+        return StalePolicy::exclude;
+    }
+    if (name == "hold")
+    {
+        return StalePolicy::hold;
+    }
+    if (name == "nonfunctional")
+    {
+        return StalePolicy::nonfunctional;
+    }
+    throw std::runtime_error("unknown stale_policy '" + name + "'");
+}
+
+inline SensorConfig parseSensor(const nlohmann::json& entry)
+{
+    SensorConfig config;
+    config.name = entry.at("name").get<std::string>();
+    config.type = entry.at("type").get<std::string>();
+    config.unit = entry.at("unit").get<std::string>();
+    config.expression = entry.at("expression").get<std::string>();
+    config.minValue = entry.value("min", config.minValue);
+    config.maxValue = entry.value("max", config.maxValue);
+    config.pollInterval =
+        std::chrono::milliseconds(entry.value("poll_ms", uint64_t{0}));
+    config.window = std::chrono::milliseconds(
+        entry.value("window_ms", uint64_t(config.window.count())));
+    config.ewmaTau = std::chrono::milliseconds(
+        entry.value("ewma_ms", uint64_t(config.ewmaTau.count())));
+    config.emit.deadband = entry.value("deadband", 0.0);
+    config.emit.deadbandPercent = entry.value("deadband_percent", 0.0);
+    config.emit.minInterval =
+        std::chrono::milliseconds(entry.value("min_interval_ms", uint64_t{0}));
+    config.emit.heartbeat =
+        std::chrono::milliseconds(entry.value("heartbeat_ms", uint64_t{0}));
+    config.readTimeout = std::chrono::milliseconds(entry.value(
+        "read_timeout_ms", uint64_t(config.readTimeout.count())));
+    if (config.readTimeout.count() == 0)
+    {
+        throw std::runtime_error("read_timeout_ms must be greater than 0");
+    }
+    config.stalePolicy =
+        parseStalePolicy(entry.value("stale_policy", std::string("exclude")));
+    auto staleMs = entry.value("stale_ms", uint64_t{0});
+
+    if (entry.contains("thresholds"))
+    {
+        const auto& limits = entry.at("thresholds");
+        auto& thresholds = config.thresholds;
+        thresholds.warningHigh =
+            limits.value("warning_high", thresholds.warningHigh);
+        thresholds.warningLow = limits.value("warning_low", thresholds.warningLow);
+        thresholds.criticalHigh =
+            limits.value("critical_high", thresholds.criticalHigh);
+        thresholds.criticalLow =
+            limits.value("critical_low", thresholds.criticalLow);
+        thresholds.hysteresis = limits.value("hysteresis", 0.0);
+    }
+
+    for (const auto& input : entry.at("inputs").items())
+    {
+        config.inputs.push_back(InputConfig{
+            input.key(), input.value().at("service").get<std::string>(),
+            input.value().at("path").get<std::string>(),
+            std::chrono::milliseconds(
+                input.value().value("stale_ms", staleMs))});
+    }
+    return config;
+}
+
+// Throws std::runtime_error naming the file on any read or schema error
+inline std::vector<SensorConfig> loadConfig(const std::string& file)
+{
+    std::ifstream in(file);
+    if (!in)
+    {
+        throw std::runtime_error("cannot open " + file);
+    }
+
+    std::vector<SensorConfig> sensors;
+    try
+    {
+        auto json = nlohmann::json::parse(in);
+        for (const auto& entry : json.at("sensors"))
+        {
+            sensors.push_back(parseSensor(entry));
+        }
+    }
+    catch (const nlohmann::json::exception& e)
+    {
+        throw std::runtime_error(file + ": " + e.what());
+    }
+    catch (const std::runtime_error& e)
+    {
+        throw std::runtime_error(file + ": " + e.what());
+    }
+    return sensors;
+}
+
+// Used when no configuration file is given: total PSU output power
+inline std::vector<SensorConfig> defaultConfig()
+{
+    SensorConfig total;
+    total.name = "Total_Power";
+    total.type = "power";
+    total.unit = "Watts";
+    total.expression = "sum(psu0, psu1)";
+    total.minValue = 0.0;
+    total.maxValue = 10000.0;
+    total.inputs = {
+        {"psu0", "xyz.openbmc_project.PSUSensor",
+         "/xyz/openbmc_project/sensors/power/PSU0_Output_Power"},
+        {"psu1", "xyz.openbmc_project.PSUSensor",
+         "/xyz/openbmc_project/sensors/power/PSU1_Output_Power"},
+    };
+    return {total};
+}
+
+} // namespace virtual_sensor
@@ -0,0 +1,133 @@
+/**
+ * Sensor Thresholds
+ *
+ * One xyz.openbmc_project.Sensor.Threshold.Warning or .Critical interface
+ * on a virtual sensor: the High and Low limits, their alarm properties and
+ * the <Level><High|Low>Alarm<Asserted|Deasserted> signals, which carry the
+ * sensor value that caused them.
+ *
+ * check() runs in the same call that computes a new sensor value, so an
+ * alarm goes out in the update that crossed the limit rather than after a
+ * separate threshold daemon has read the value back over D-Bus. Alarms
+ * follow the dbus-sensors rule:
+ *   - a high alarm asserts when value >= limit and clears when
+ *     value < limit - hysteresis;
+ *   - a low alarm asserts when value <= limit and clears when
+ *     value > limit + hysteresis.
+ * An unavailable (NaN) value leaves the alarms as they are.
+ */
+
+#pragma once
+
+#include <sdbusplus/asio/object_server.hpp>
+
+#include <cmath>
+#include <memory>
+#include <string>
+
+class ThresholdInterface
+{
+  public:
+    // `level` is "Warning" or "Critical"; a NaN limit is not checked
+    ThresholdInterface(sdbusplus::asio::object_server& server,
+                       const std::string& path, const std::string& level,
+                       double high, double low, double hysteresis) :
+        hysteresis_(hysteresis),
+        high_{high, false, true, level + "AlarmHigh",
+              level + "HighAlarmAsserted", level + "HighAlarmDeasserted"},
+        low_{low, false, false, level + "AlarmLow", level + "LowAlarmAsserted",
+             level + "LowAlarmDeasserted"}
+    {
+        iface_ = server.add_interface(
+            path, "xyz.openbmc_project.Sensor.Threshold." + level);
+
+        iface_->register_property_r(
+            level + "High", high_.limit, sdbusplus::vtable::property_::const_,
+            [this](const double&) { return high_.limit; });
+        iface_->register_property_r(
+            level + "Low", low_.limit, sdbusplus::vtable::property_::const_,
+            [this](const double&) { return low_.limit; });
+
+        for (Bound* bound : {&high_, &low_})
+        {
+            iface_->register_property_r(
+                bound->property, bound->alarm,
+                sdbusplus::vtable::property_::emits_change,
+                [bound](const bool&) { return bound->alarm; });
+            iface_->register_signal<double>(bound->asserted);
+            iface_->register_signal<double>(bound->deasserted);
+        }
+
+        iface_->initialize();
+    }
+
+    ThresholdInterface(const ThresholdInterface&) = delete;
+    ThresholdInterface& operator=(const ThresholdInterface&) = delete;
+
+    void check(double value)
+    {
+        if (std::isnan(value))
+        {
+            return;
+        }
+        check(high_, value);
+        check(low_, value);
+    }
+
+    bool alarmHigh() const
+    {
+        return high_.alarm;
+    }
+
+    bool alarmLow() const
+    {
+        return low_.alarm;
+    }
+
+  private:
+    struct Bound
+    {
+        double limit;
+        bool alarm;
+        bool high;
+        // Member names, built once
+        std::string property;
+        std::string asserted;
+        std::string deasserted;
+    };
+
+    void check(Bound& bound, double value)
+    {
+        if (std::isnan(bound.limit))
+        {
+            return;
+        }
+        bool alarm = bound.alarm;
+        if (bound.high)
+        {
+            alarm = alarm ? value >= bound.limit - hysteresis_
+                          : value >= bound.limit;
+        }
+        else
+        {
+            alarm = alarm ? value <= bound.limit + hysteresis_
+                          : value <= bound.limit;
+        }
+        if (alarm == bound.alarm)
+        {
+            return;
+        }
+
+        bound.alarm = alarm;
+        iface_->signal_property(bound.property);
+        auto signal = iface_->new_signal(
+            (alarm ? bound.asserted : bound.deasserted).c_str());
+        signal.append(value);
+        signal.signal_send();
+    }
+
+    std::shared_ptr<sdbusplus::asio::dbus_interface> iface_;
+    const double hysteresis_;
+    Bound high_;
+    Bound low_;
+};
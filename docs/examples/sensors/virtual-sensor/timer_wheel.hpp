@@ -0,0 +1,236 @@
+/**
+ * Hierarchical Timer Wheel
+ *
+ * Schedules thousands of periodic callbacks on one steady_timer instead
+ * of one steady_timer (and one pending asio operation) each.
+ *
+ * Time is counted in ticks. Four levels of 64 slots cover 64, 64^2, 64^3
+ * and 64^4 ticks ahead; with a 100 ms tick that is 6.4 s, 6.8 min, 7.3 h
+ * and 19 days. A timer is placed in the lowest level whose range covers
+ * its expiry. When level 0 wraps, the matching slot of level 1 is
+ * cascaded down, and so on up the levels. Arming, cancelling and firing a
+ * timer are O(1). Timers live in one deque and are linked into their
+ * slot through indices, so arming an existing timer never allocates and
+ * callbacks may add new timers while they run.
+ *
+ * The wheel does not own a clock. The owner calls advance() with the
+ * number of ticks that have elapsed and may use ticksUntilNext() to sleep
+ * until something is due instead of waking every tick.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+class TimerWheel
+{
+  public:
+    using Id = uint32_t;
+    using Callback = std::function<void()>;
+
+    static constexpr Id npos = UINT32_MAX;
+    static constexpr unsigned slotBits = 6;
+    static constexpr size_t slotsPerLevel = size_t{1} << slotBits;
+    static constexpr size_t levels = 4;
+    static constexpr uint64_t maxDelay =
+        (uint64_t{1} << (slotBits * levels)) - 1;
+
+    // Register a callback; the timer stays idle until arm()
+    Id add(Callback callback)
+    {
+        auto id = static_cast<Id>(timers_.size());
+        timers_.push_back(Timer{std::move(callback)});
+        return id;
+    }
+
+    // (Re)arm `id` to fire once, `delay` ticks from now (at least one)
+    void arm(Id id, uint64_t delay)
+    {
+        cancel(id);
+        timers_[id].expiry = now_ + std::clamp<uint64_t>(delay, 1, maxDelay);
+        insert(id);
+        ++armed_;
+    }
+
+    void cancel(Id id)
+    {
+        if (timers_[id].slot != npos)
+        {
+            unlink(id);
+            --armed_;
+        }
+    }
+
+    bool armed(Id id) const
+    {
+        return timers_[id].slot != npos;
+    }
+
+    size_t armedCount() const
+    {
+        return armed_;
+    }
+
+    size_t size() const
+    {
+        return timers_.size();
+    }
+
+    uint64_t now() const
+    {
+        return now_;
+    }
+
+    // Move time forward, running every callback that falls due on the way
+    void advance(uint64_t ticks)
+    {
+        for (; ticks > 0; --ticks)
+        {
+            if (armed_ == 0)
+            {
+                now_ += ticks; // nothing to cascade or fire on the way
+                return;
+            }
+            ++now_;
+            cascade();
+            fire(now_ & (slotsPerLevel - 1));
+        }
+    }
+
+    /**
+     * Ticks the owner may sleep before the next call to advance() could
+     * run anything: exact when the next timer is in level 0, otherwise
+     * the distance to the next level-0 wrap, where a cascade may bring
+     * timers down. 0 when nothing is armed.
+     */
+    uint64_t ticksUntilNext() const
+    {
+        if (armed_ == 0)
+        {
+            return 0;
+        }
+        for (uint64_t ahead = 1; ahead <= slotsPerLevel; ++ahead)
+        {
+            uint64_t tick = now_ + ahead;
+            if (heads_[tick & (slotsPerLevel - 1)] != npos ||
+                (tick & (slotsPerLevel - 1)) == 0)
+            {
+                return ahead;
+            }
+        }
+        return slotsPerLevel;
+    }
+
+  private:
+    struct Timer
+    {
+        Callback callback;
+        uint64_t expiry = 0;
+        uint32_t slot = npos; // index into heads_, npos while idle
+        Id prev = npos;
+        Id next = npos;
+    };
+
+    static size_t slotIndex(size_t level, uint64_t tick)
+    {
+        return level * slotsPerLevel +
+               ((tick >> (slotBits * level)) & (slotsPerLevel - 1));
+    }
+
+    void insert(Id id)
+    {
+        auto& timer = timers_[id];
+        uint64_t delta = timer.expiry > now_ ? timer.expiry - now_ : 1;
+        size_t level = 0;
+        while (level + 1 < levels &&
+               delta >= (uint64_t{1} << (slotBits * (level + 1))))
+        {
+            ++level;
+        }
+        auto slot = static_cast<uint32_t>(slotIndex(level, timer.expiry));
+
+        timer.slot = slot;
+        timer.prev = npos;
+        timer.next = heads_[slot];
+        if (timer.next != npos)
+        {
+            timers_[timer.next].prev = id;
+        }
+        heads_[slot] = id;
+    }
+
+    void unlink(Id id)
+    {
+        auto& timer = timers_[id];
+        if (timer.prev != npos)
+        {
+            timers_[timer.prev].next = timer.next;
+        }
+        else
+        {
+            heads_[timer.slot] = timer.next;
+        }
+        if (timer.next != npos)
+        {
+            timers_[timer.next].prev = timer.prev;
+        }
+        timer.slot = npos;
+        timer.prev = timer.next = npos;
+    }
+
+    // When level 0 wraps, move the current slot of level 1 down into the
+    // lower levels; when level 1 wraps too, level 2 first, and so on
+    void cascade()
+    {
+        size_t top = 0;
+        while (top + 1 < levels &&
+               (now_ & ((uint64_t{1} << (slotBits * (top + 1))) - 1)) == 0)
+        {
+            ++top;
+        }
+        for (size_t level = top; level > 0; --level)
+        {
+            size_t slot = slotIndex(level, now_);
+            Id id = heads_[slot];
+            heads_[slot] = npos;
+            while (id != npos)
+            {
+                Id next = timers_[id].next;
+                insert(id);
+                id = next;
+            }
+        }
+    }
+
+    void fire(size_t slot)
+    {
+        // Callbacks may re-arm themselves; they always land in a later slot
+        while (heads_[slot] != npos)
+        {
+            Id id = heads_[slot];
+            unlink(id);
+            --armed_;
+            timers_[id].callback();
+        }
+    }
+
+    std::deque<Timer> timers_;
+    std::array<Id, levels * slotsPerLevel> heads_ = emptyHeads();
+    size_t armed_ = 0;
+    uint64_t now_ = 0;
+
+    static constexpr std::array<Id, levels * slotsPerLevel> emptyHeads()
+    {
+        std::array<Id, levels * slotsPerLevel> heads{};
+        for (auto& head : heads)
+        {
+            head = npos;
+        }
+        return heads;
+    }
+};
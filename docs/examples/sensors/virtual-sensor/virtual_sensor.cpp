@@ -1,8 +1,22 @@
 /**
  * Virtual Sensor Example
  *
- * Demonstrates creating a virtual sensor that calculates total system power
- * by reading PSU power values and summing them.
+ * Demonstrates creating virtual sensors whose values are computed from
+ * other sensors. Without arguments it publishes total system power, the
+ * sum of the PSU output power sensors; with a configuration file
+ * (sensor_config.hpp) one process hosts any number of derived sensors
+ * such as per-rail efficiency, inlet/outlet deltas or weighted averages.
+ *
+ * Each sensor's expression is compiled once at startup (expression.hpp)
+ * and re-evaluated only when one of its own inputs changes, without
+ * allocating. All sensors share one connection, one object_server and
+ * one subscription per distinct input (virtual_sensor.hpp).
+ *
+ * The sensors do not poll unless configured to. Every input has a
+ * PropertiesChanged subscription and is read once with an async Get at
+ * startup; after that there is no bus traffic unless an input changes,
+ * and outputs update as soon as their inputs do. Inputs of sensors with
+ * `poll_ms` are also re-read on a shared timer wheel.
  *
  * Source Reference:
  *   - virtual-sensor: https://github.com/openbmc/phosphor-virtual-sensor
@@ -12,136 +26,42 @@
  * Build with SDK:
  *   $CXX -std=c++20 virtual_sensor.cpp -o virtual_sensor \
  *       $(pkg-config --cflags --libs sdbusplus)
+ *
+ * Usage:
+ *   ./virtual_sensor                        # Total_Power from PSU0/PSU1
+ *   ./virtual_sensor virtual_sensors.json   # Sensors from a config file
  */
 
-#include <sdbusplus/bus.hpp>
 #include <sdbusplus/asio/connection.hpp>
-#include <sdbusplus/asio/object_server.hpp>
-#include <boost/asio.hpp>
+#include <boost/asio/io_context.hpp>
+#include "virtual_sensor.hpp"
 #include <iostream>
-#include <vector>
+#include <memory>
 #include <string>
-#include <chrono>
+#include <vector>
 
 // Configuration
 constexpr auto serviceName = "xyz.openbmc_project.VirtualSensor.TotalPower";
-constexpr auto objectPath = "/xyz/openbmc_project/sensors/power/Total_Power";
-constexpr auto sensorInterface = "xyz.openbmc_project.Sensor.Value";
 
-// PSU sensor paths to aggregate
-const std::vector<std::string> psuSensorPaths = {
-    "/xyz/openbmc_project/sensors/power/PSU0_Output_Power",
-    "/xyz/openbmc_project/sensors/power/PSU1_Output_Power"
-};
-
-class VirtualSensor
+int main(int argc, char* argv[])
 {
-  public:
-    VirtualSensor(boost::asio::io_context& io,
-                  std::shared_ptr<sdbusplus::asio::connection> conn) :
-        io_(io),
-        conn_(conn), timer_(io), value_(0.0), minValue_(0.0), maxValue_(10000.0)
+    std::vector<virtual_sensor::SensorConfig> configs;
+    try
     {
-        // Create object server
-        server_ = std::make_unique<sdbusplus::asio::object_server>(conn_);
-
-        // Add sensor interface
-        iface_ = server_->add_interface(objectPath, sensorInterface);
-
-        // Register Value property (read-only)
-        iface_->register_property_r(
-            "Value", value_, sdbusplus::vtable::property_::emits_change,
-            [this](const double&) { return value_; });
-
-        // Register Unit property
-        std::string unit = "xyz.openbmc_project.Sensor.Value.Unit.Watts";
-        iface_->register_property_r(
-            "Unit", unit, sdbusplus::vtable::property_::const_,
-            [unit](const std::string&) { return unit; });
-
-        // Register MinValue property
-        iface_->register_property_r(
-            "MinValue", minValue_, sdbusplus::vtable::property_::const_,
-            [this](const double&) { return minValue_; });
-
-        // Register MaxValue property
-        iface_->register_property_r(
-            "MaxValue", maxValue_, sdbusplus::vtable::property_::const_,
-            [this](const double&) { return maxValue_; });
-
-        iface_->initialize();
-
-        std::cout << "Virtual sensor created at: " << objectPath << "\n";
-
-        // Start periodic update
-        startUpdate();
+        configs = argc > 1 ? virtual_sensor::loadConfig(argv[1])
+                           : virtual_sensor::defaultConfig();
     }
-
-  private:
-    void startUpdate()
+    catch (const std::exception& e)
     {
-        timer_.expires_after(std::chrono::seconds(1));
-        timer_.async_wait([this](const boost::system::error_code& ec) {
-            if (!ec)
-            {
-                updateValue();
-                startUpdate();
-            }
-        });
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
     }
-
-    void updateValue()
+    if (configs.empty())
     {
-        double totalPower = 0.0;
-        bool anyValid = false;
-
-        for (const auto& path : psuSensorPaths)
-        {
-            try
-            {
-                auto method = conn_->new_method_call(
-                    "xyz.openbmc_project.PSUSensor", path.c_str(),
-                    "org.freedesktop.DBus.Properties", "Get");
-                method.append(sensorInterface, "Value");
-
-                auto reply = conn_->call(method);
-                std::variant<double> value;
-                reply.read(value);
-
-                double psuPower = std::get<double>(value);
-                if (!std::isnan(psuPower))
-                {
-                    totalPower += psuPower;
-                    anyValid = true;
-                }
-            }
-            catch (const std::exception& e)
-            {
-                // PSU sensor not available, skip
-            }
-        }
-
-        if (anyValid)
-        {
-            value_ = totalPower;
-            iface_->signal_property("Value");
-            std::cout << "Total Power: " << value_ << " W\n";
-        }
+        std::cerr << "Error: no sensors configured\n";
+        return 1;
     }
 
-    boost::asio::io_context& io_;
-    std::shared_ptr<sdbusplus::asio::connection> conn_;
-    std::unique_ptr<sdbusplus::asio::object_server> server_;
-    std::shared_ptr<sdbusplus::asio::dbus_interface> iface_;
-    boost::asio::steady_timer timer_;
-
-    double value_;
-    double minValue_;
-    double maxValue_;
-};
-
-int main()
-{
     boost::asio::io_context io;
     auto conn = std::make_shared<sdbusplus::asio::connection>(io);
 
@@ -149,12 +69,30 @@ int main()
     conn->request_name(serviceName);
     std::cout << "Service: " << serviceName << "\n";
 
-    // Create virtual sensor
-    VirtualSensor sensor(io, conn);
+    // One connection, object server and timer for every hosted sensor
+    VirtualSensorManager manager(conn);
+    for (const auto& config : configs)
+    {
+        try
+        {
+            manager.add(config);
+        }
+        catch (const expression::CompileError& e)
+        {
+            std::cerr << config.name << ": bad expression '"
+                      << config.expression << "': " << e.what() << "\n";
+            return 1;
+        }
+        std::cout << "Virtual sensor created at: " << config.objectPath()
+                  << " = " << config.expression << "\n";
+    }
+    std::cout << manager.sensorCount() << " sensors, "
+              << manager.inputCount() << " distinct inputs\n";
 
-    std::cout << "\nVirtual sensor running. Test with:\n";
-    std::cout << "  busctl get-property " << serviceName << " " << objectPath
-              << " " << sensorInterface << " Value\n";
+    std::cout << "\nVirtual sensors running. Test with:\n";
+    std::cout << "  busctl get-property " << serviceName << " "
+              << configs.front().objectPath() << " " << sensorInterface
+              << " Value\n";
     std::cout << "\nPress Ctrl+C to exit.\n";
 
     io.run();
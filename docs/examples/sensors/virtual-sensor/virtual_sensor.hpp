@@ -0,0 +1,943 @@
+/**
+ * Virtual Sensor Host
+ *
+ * VirtualSensorManager hosts any number of VirtualSensor objects on one
+ * D-Bus connection and one object_server.
+ *
+ * Inputs are shared: every distinct input path gets one slot in a value
+ * array, one PropertiesChanged match and one initial Get, however many
+ * sensors use it. Expressions resolve their variables straight to those
+ * slots, and each input keeps the list of sensors that depend on it, so a
+ * change re-evaluates exactly those sensors.
+ *
+ * Expressions may also read rolling statistics of an input, e.g.
+ * `psu0.ewma` or `psu0.p95` (window_stats.hpp). Those are kept only for
+ * inputs that some expression asks about, and each statistic is a value
+ * slot of its own, so sensors are re-evaluated only when it changes.
+ *
+ * Every read is an async Get bounded by the sensor's `read_timeout_ms`,
+ * so a hung input service cannot hold up the loop. Each input service
+ * also gets one NameOwnerChanged match: when the service leaves the bus
+ * its inputs go stale at once and reads of them stop; when it comes back
+ * they are read again. An input with a freshness deadline (`stale_ms`)
+ * that has not changed for that long is read again, and goes stale if
+ * that read fails. Each sensor's StalePolicy then decides whether a stale
+ * input counts as unavailable, keeps its last value, or keeps it and
+ * turns the sensor's OperationalStatus.Functional off.
+ *
+ * Thresholds (threshold.hpp) are checked inside VirtualSensor::evaluate(),
+ * so alarms are raised in the same update that computed the value,
+ * ahead of any deadband or rate limit on the Value signal.
+ *
+ * Periodic re-reads (`poll_ms`), freshness checks and statistics sampling
+ * run on a single
+ * hierarchical timer wheel (timer_wheel.hpp) driven by one steady_timer
+ * that sleeps until the next due slot, rather than a steady_timer per
+ * sensor.
+ *
+ * Evaluating a sensor only updates the value that Get returns. Sensors
+ * whose result moved are queued, and one handler posted to the io_context
+ * sends their PropertiesChanged signals, so a burst of input changes
+ * handled in the same loop iteration costs each sensor at most one signal.
+ * That handler also applies the sensor's EmitPolicy (deadband, minimum
+ * interval, heartbeat); held-back and heartbeat signals use one wheel
+ * timer per sensor.
+ */
+
+#pragma once
+
+#include <sdbusplus/asio/connection.hpp>
+#include <sdbusplus/asio/object_server.hpp>
+#include <sdbusplus/bus/match.hpp>
+#include <sdbusplus/exception.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include "expression.hpp"
+#include "sensor_config.hpp"
+#include "threshold.hpp"
+#include "timer_wheel.hpp"
+#include "window_stats.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+constexpr auto sensorInterface = "xyz.openbmc_project.Sensor.Value";
+constexpr auto propertiesInterface = "org.freedesktop.DBus.Properties";
+constexpr auto operationalStatusInterface =
+    "xyz.openbmc_project.State.Decorator.OperationalStatus";
+
+// Sensor.Value carries doubles plus the Unit string
+using SensorProperty = std::variant<double, std::string>;
+
+/**
+ * One published sensor. Owns its D-Bus interface and compiled expression;
+ * input values live in the manager.
+ */
+class VirtualSensor
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    // `resolve` maps a config input name to the manager's value slot
+    VirtualSensor(sdbusplus::asio::object_server& server,
+                  const virtual_sensor::SensorConfig& config,
+                  const expression::Resolver& resolve) :
+        config_(config), value_(std::numeric_limits<double>::quiet_NaN()),
+        signalled_(value_), minValue_(config.minValue), maxValue_(config.maxValue)
+    {
+        program_ = expression::compile(config_.expression, resolve);
+
+        // Add sensor interface
+        iface_ = server.add_interface(config_.objectPath(), sensorInterface);
+
+        // Register Value property (read-only)
+        iface_->register_property_r(
+            "Value", value_, sdbusplus::vtable::property_::emits_change,
+            [this](const double&) { return value_; });
+
+        // Register Unit property
+        std::string unit = config_.unitValue();
+        iface_->register_property_r(
+            "Unit", unit, sdbusplus::vtable::property_::const_,
+            [unit](const std::string&) { return unit; });
+
+        // Register MinValue property
+        iface_->register_property_r(
+            "MinValue", minValue_, sdbusplus::vtable::property_::const_,
+            [this](const double&) { return minValue_; });
+
+        // Register MaxValue property
+        iface_->register_property_r(
+            "MaxValue", maxValue_, sdbusplus::vtable::property_::const_,
+            [this](const double&) { return maxValue_; });
+
+        iface_->initialize();
+
+        // Functional tracks input freshness, for the nonfunctional policy
+        if (config_.stalePolicy == virtual_sensor::StalePolicy::nonfunctional)
+        {
+            statusIface_ = server.add_interface(config_.objectPath(),
+                                                operationalStatusInterface);
+            statusIface_->register_property_r(
+                "Functional", functional_,
+                sdbusplus::vtable::property_::emits_change,
+                [this](const bool&) { return functional_; });
+            statusIface_->initialize();
+        }
+
+        const auto& limits = config_.thresholds;
+        if (limits.warning())
+        {
+            warning_ = std::make_unique<ThresholdInterface>(
+                server, config_.objectPath(), "Warning", limits.warningHigh,
+                limits.warningLow, limits.hysteresis);
+        }
+        if (limits.critical())
+        {
+            critical_ = std::make_unique<ThresholdInterface>(
+                server, config_.objectPath(), "Critical", limits.criticalHigh,
+                limits.criticalLow, limits.hysteresis);
+        }
+    }
+
+    VirtualSensor(const VirtualSensor&) = delete;
+    VirtualSensor& operator=(const VirtualSensor&) = delete;
+
+    // Re-evaluate over the manager's input values and check thresholds;
+    // true if the result moved. The manager decides when to signal().
+    bool evaluate(std::span<const double> values)
+    {
+        double result = program_.evaluate(values);
+        if (sameValue(result, value_))
+        {
+            return false;
+        }
+        value_ = result;
+        if (warning_)
+        {
+            warning_->check(value_);
+        }
+        if (critical_)
+        {
+            critical_->check(value_);
+        }
+        return true;
+    }
+
+    // Whether the value moved past the deadband since the last signal.
+    // Becoming available or unavailable always counts.
+    bool outsideDeadband() const
+    {
+        if (sameValue(value_, signalled_))
+        {
+            return false;
+        }
+        if (std::isnan(value_) || std::isnan(signalled_))
+        {
+            return true;
+        }
+        const auto& policy = config_.emit;
+        double delta = std::abs(value_ - signalled_);
+        return delta >= policy.deadband &&
+               delta >= policy.deadbandPercent / 100.0 * std::abs(signalled_);
+    }
+
+    // Send PropertiesChanged for the current value
+    void signal(Clock::time_point now)
+    {
+        signalled_ = value_;
+        lastSignal_ = now;
+        ++signals_;
+        iface_->signal_property("Value");
+    }
+
+    // No-op unless the sensor has the OperationalStatus interface
+    void setFunctional(bool functional)
+    {
+        if (!statusIface_ || functional == functional_)
+        {
+            return;
+        }
+        functional_ = functional;
+        statusIface_->signal_property("Functional");
+    }
+
+    Clock::time_point lastSignal() const
+    {
+        return lastSignal_;
+    }
+
+    uint64_t signals() const
+    {
+        return signals_;
+    }
+
+    const virtual_sensor::SensorConfig& config() const
+    {
+        return config_;
+    }
+
+    const expression::Program& program() const
+    {
+        return program_;
+    }
+
+    double value() const
+    {
+        return value_;
+    }
+
+  private:
+    // NaN (unavailable) counts as equal to NaN
+    static bool sameValue(double a, double b)
+    {
+        return a == b || (std::isnan(a) && std::isnan(b));
+    }
+
+    std::shared_ptr<sdbusplus::asio::dbus_interface> iface_;
+    std::shared_ptr<sdbusplus::asio::dbus_interface> statusIface_;
+    std::unique_ptr<ThresholdInterface> warning_;
+    std::unique_ptr<ThresholdInterface> critical_;
+    const virtual_sensor::SensorConfig config_;
+    expression::Program program_;
+
+    double value_;
+    double signalled_; // last value sent in PropertiesChanged
+    Clock::time_point lastSignal_{};
+    uint64_t signals_ = 0;
+    bool functional_ = false; // inputs have no value yet
+    double minValue_;
+    double maxValue_;
+};
+
+class VirtualSensorManager
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit VirtualSensorManager(
+        std::shared_ptr<sdbusplus::asio::connection> conn,
+        std::chrono::milliseconds tick = std::chrono::milliseconds(100)) :
+        conn_(conn), server_(conn_), clock_(conn_->get_io_context()),
+        tick_(tick), epoch_(Clock::now())
+    {}
+
+    VirtualSensorManager(const VirtualSensorManager&) = delete;
+    VirtualSensorManager& operator=(const VirtualSensorManager&) = delete;
+
+    /**
+     * Publish one sensor. Its inputs are subscribed and read on first use
+     * and shared with every other sensor naming the same path. A variable
+     * `<input>.<stat>` reads windowed statistics of that input instead of
+     * its value; see statSlot().
+     * Throws expression::CompileError for a bad expression.
+     */
+    VirtualSensor& add(const virtual_sensor::SensorConfig& config)
+    {
+        auto index = static_cast<uint32_t>(sensors_.size());
+        auto resolve = [this, &config](std::string_view name) {
+            auto dot = name.find('.');
+            auto base = name.substr(0, dot);
+            for (const auto& input : config.inputs)
+            {
+                if (input.name != base)
+                {
+                    continue;
+                }
+                uint32_t in = inputIndex(input, config);
+                return dot == std::string_view::npos
+                           ? inputs_[in].slot
+                           : statSlot(in, name.substr(dot + 1), config);
+            }
+            return expression::npos;
+        };
+        auto& sensor = *sensors_.emplace_back(
+            std::make_unique<VirtualSensor>(server_, config, resolve));
+        marks_.push_back(0);
+        queued_.push_back(false);
+        emitTimers_.push_back(TimerWheel::npos);
+        if (config.emit.timed())
+        {
+            emitTimers_[index] =
+                wheel_.add([this, index]() { emit(index, Clock::now()); });
+        }
+
+        for (auto slot : sensor.program().inputs())
+        {
+            dependents_[slot].push_back(index);
+            if (config.pollInterval.count() > 0)
+            {
+                poll(owners_[slot], config.pollInterval);
+            }
+        }
+        // Inputs already known to other sensors have a value by now
+        sensor.evaluate(valuesFor(sensor));
+        queue(index);
+        updateFunctional(index);
+        return sensor;
+    }
+
+    size_t sensorCount() const
+    {
+        return sensors_.size();
+    }
+
+    // Distinct input paths, which is also the number of matches installed
+    size_t inputCount() const
+    {
+        return inputs_.size();
+    }
+
+    size_t polledCount() const
+    {
+        return polled_;
+    }
+
+    // PropertiesChanged signals sent for all sensors so far
+    uint64_t signalCount() const
+    {
+        uint64_t total = 0;
+        for (const auto& sensor : sensors_)
+        {
+            total += sensor->signals();
+        }
+        return total;
+    }
+
+    /**
+     * Windowed statistics kept for an input path, or nullptr if no
+     * expression uses them. The pointer is stable; once configuration is
+     * done, other threads may call snapshot() on it at any time.
+     */
+    const WindowStats* stats(const std::string& path) const
+    {
+        auto it = inputByPath_.find(path);
+        return it == inputByPath_.end() ? nullptr
+                                        : inputs_[it->second].stats.get();
+    }
+
+  private:
+    struct Input
+    {
+        std::string service;
+        std::string path;
+        uint32_t owner = 0;     // index into services_
+        uint32_t slot = 0;      // index into values_
+        bool signalled = false; // a signal is newer than any Get reply
+        bool reading = false;   // a Get is outstanding
+        bool stale = true;      // no value yet; see sensor_config.hpp
+        std::unique_ptr<sdbusplus::bus::match_t> match;
+        TimerWheel::Id poll = TimerWheel::npos;
+        uint64_t pollTicks = 0;
+
+        // The shortest of each asked for by the sensors sharing the input
+        std::chrono::milliseconds readTimeout{0};
+        std::chrono::milliseconds staleAfter{0};
+        TimerWheel::Id deadline = TimerWheel::npos;
+        Clock::time_point updated{};
+
+        // Present once an expression names <input>.<stat>
+        std::unique_ptr<WindowStats> stats;
+        std::array<uint32_t, WindowStats::statCount> statSlots{};
+        TimerWheel::Id sampler = TimerWheel::npos;
+        uint64_t sampleTicks = 0;
+    };
+
+    // One per input service, however many inputs it provides
+    struct Service
+    {
+        std::string name;
+        bool owned = true;    // until the bus says otherwise
+        bool changed = false; // NameOwnerChanged seen; newer than the query
+        std::vector<uint32_t> inputs;
+        std::unique_ptr<sdbusplus::bus::match_t> match;
+    };
+
+    static constexpr std::array<std::string_view, WindowStats::statCount>
+        statNames = {"min", "max", "mean", "ewma", "p50", "p90", "p95", "p99"};
+
+    // New value slot; `owner` is the input it belongs to
+    uint32_t addSlot(uint32_t owner)
+    {
+        auto slot = static_cast<uint32_t>(values_.size());
+        values_.push_back(std::numeric_limits<double>::quiet_NaN());
+        live_.push_back(std::numeric_limits<double>::quiet_NaN());
+        dependents_.emplace_back();
+        owners_.push_back(owner);
+        return slot;
+    }
+
+    // Index of an input path, subscribing and reading it the first time
+    uint32_t inputIndex(const virtual_sensor::InputConfig& config,
+                        const virtual_sensor::SensorConfig& sensor)
+    {
+        auto [it, added] = inputByPath_.try_emplace(
+            config.path, static_cast<uint32_t>(inputs_.size()));
+        uint32_t in = it->second;
+        if (!added)
+        {
+            auto& input = inputs_[in];
+            // The shortest wins; configs never hold 0 (sd-bus's default)
+            input.readTimeout = std::min(input.readTimeout, sensor.readTimeout);
+            watchFreshness(in, config.staleAfter);
+            return in;
+        }
+
+        auto& input = inputs_.emplace_back();
+        input.service = config.service;
+        input.path = config.path;
+        input.slot = addSlot(in);
+        input.readTimeout = sensor.readTimeout;
+
+        // Subscribe first, then read, so no change between the two is lost
+        watchService(in);
+        subscribe(in);
+        read(in);
+        watchFreshness(in, config.staleAfter);
+        return in;
+    }
+
+    /**
+     * Follow the owner of input `in`'s service with one NameOwnerChanged
+     * match per service. Its inputs go stale as soon as it leaves the bus
+     * and are read again when it returns. A GetNameOwner after subscribing
+     * finds services that are missing from the start.
+     */
+    void watchService(uint32_t in)
+    {
+        const auto& name = inputs_[in].service;
+        auto [it, added] = serviceByName_.try_emplace(
+            name, static_cast<uint32_t>(services_.size()));
+        uint32_t owner = it->second;
+        inputs_[in].owner = owner;
+        if (!added)
+        {
+            services_[owner].inputs.push_back(in);
+            return;
+        }
+
+        auto& service = services_.emplace_back();
+        service.name = name;
+        service.inputs.push_back(in);
+
+        namespace rules = sdbusplus::bus::match::rules;
+        service.match = std::make_unique<sdbusplus::bus::match_t>(
+            *conn_, rules::nameOwnerChanged(name),
+            [this, owner](sdbusplus::message_t& msg) {
+                std::string name;
+                std::string oldOwner;
+                std::string newOwner;
+                try
+                {
+                    msg.read(name, oldOwner, newOwner);
+                }
+                catch (const sdbusplus::exception::exception&)
+                {
+                    return; // malformed; must not end the daemon
+                }
+                services_[owner].changed = true;
+                setOwned(owner, !newOwner.empty());
+            });
+
+        conn_->async_method_call(
+            [this, owner](const boost::system::error_code& ec,
+                          const std::string&) {
+                if (!services_[owner].changed)
+                {
+                    setOwned(owner, !ec);
+                }
+            },
+            "org.freedesktop.DBus", "/org/freedesktop/DBus",
+            "org.freedesktop.DBus", "GetNameOwner", name);
+    }
+
+    void setOwned(uint32_t owner, bool owned)
+    {
+        auto& service = services_[owner];
+        if (service.owned == owned)
+        {
+            return;
+        }
+        service.owned = owned;
+        for (auto in : service.inputs)
+        {
+            if (owned)
+            {
+                read(in);
+            }
+            else
+            {
+                markStale(in);
+            }
+        }
+    }
+
+    // Check input `in` for staleness every `staleAfter` without a change;
+    // the shortest deadline asked wins
+    void watchFreshness(uint32_t in, std::chrono::milliseconds staleAfter)
+    {
+        auto& input = inputs_[in];
+        if (staleAfter.count() <= 0 ||
+            (input.deadline != TimerWheel::npos &&
+             input.staleAfter <= staleAfter))
+        {
+            return;
+        }
+        if (input.deadline == TimerWheel::npos)
+        {
+            input.deadline = wheel_.add([this, in]() { checkFreshness(in); });
+        }
+        input.staleAfter = staleAfter;
+
+        syncWheel();
+        armAfter(input.deadline, staleAfter);
+        scheduleClock();
+    }
+
+    // Deadline timer callback. Stores do not re-arm the timer; it re-arms
+    // itself here for whatever is left of the deadline.
+    void checkFreshness(uint32_t in)
+    {
+        auto& input = inputs_[in];
+        auto idle = Clock::now() - input.updated;
+        if (idle < input.staleAfter)
+        {
+            armAfter(input.deadline, input.staleAfter - idle);
+            return;
+        }
+        armAfter(input.deadline, input.staleAfter);
+        read(in); // markStale() if it fails or times out
+    }
+
+    /**
+     * Slot holding statistic `name` (min, max, mean, ewma, p50, p90, p95,
+     * p99) of input `in`, or npos for an unknown name. The first sensor to
+     * ask sets the window and EWMA time constant; the input is then sampled
+     * every window / WindowStats::capacity on the timer wheel.
+     */
+    uint32_t statSlot(uint32_t in, std::string_view name,
+                      const virtual_sensor::SensorConfig& config)
+    {
+        auto stat = std::find(statNames.begin(), statNames.end(), name);
+        if (stat == statNames.end())
+        {
+            return expression::npos;
+        }
+
+        auto& input = inputs_[in];
+        if (!input.stats)
+        {
+            input.stats = std::make_unique<WindowStats>(config.window,
+                                                        config.ewmaTau);
+            input.statSlots.fill(expression::npos);
+            input.sampleTicks = std::max<uint64_t>(
+                config.window / WindowStats::capacity / tick_, 1);
+            input.sampler = wheel_.add([this, in]() {
+                wheel_.arm(inputs_[in].sampler, inputs_[in].sampleTicks);
+                sample(in);
+            });
+            syncWheel();
+            wheel_.arm(input.sampler, input.sampleTicks);
+            scheduleClock();
+        }
+
+        auto& slot = input.statSlots[stat - statNames.begin()];
+        if (slot == expression::npos)
+        {
+            slot = addSlot(in);
+        }
+        return slot;
+    }
+
+    void subscribe(uint32_t in)
+    {
+        namespace rules = sdbusplus::bus::match::rules;
+        inputs_[in].match = std::make_unique<sdbusplus::bus::match_t>(
+            *conn_, rules::propertiesChanged(inputs_[in].path, sensorInterface),
+            [this, in](sdbusplus::message_t& msg) {
+                std::string iface;
+                std::map<std::string, SensorProperty> changed;
+                try
+                {
+                    msg.read(iface, changed);
+                }
+                catch (const sdbusplus::exception::exception&)
+                {
+                    return; // malformed; must not end the daemon
+                }
+
+                auto it = changed.find("Value");
+                if (it == changed.end())
+                {
+                    return;
+                }
+                if (const double* value = std::get_if<double>(&it->second))
+                {
+                    inputs_[in].signalled = true;
+                    store(in, *value);
+                }
+            });
+    }
+
+    // Async Get of input `in`, bounded by its read timeout. Nothing is sent
+    // while the service has no owner.
+    void read(uint32_t in)
+    {
+        auto& input = inputs_[in];
+        if (input.reading || !services_[input.owner].owned)
+        {
+            return;
+        }
+        input.reading = true;
+        input.signalled = false;
+        auto timeout =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                input.readTimeout);
+        conn_->async_method_call_timed(
+            [this, in](const boost::system::error_code& ec,
+                       const std::variant<double>& value) {
+                inputs_[in].reading = false;
+                if (inputs_[in].signalled)
+                {
+                    return; // a newer value arrived meanwhile
+                }
+                // Failed or timed out: stale until its next
+                // PropertiesChanged, poll or returning owner
+                if (ec)
+                {
+                    markStale(in);
+                    return;
+                }
+                store(in, std::get<double>(value));
+            },
+            input.service, input.path, propertiesInterface, "Get",
+            static_cast<uint64_t>(timeout.count()), sensorInterface, "Value");
+    }
+
+    void store(uint32_t in, double value)
+    {
+        auto& input = inputs_[in];
+        input.updated = Clock::now();
+        values_[input.slot] = value;
+        live_[input.slot] = value;
+
+        ++pass_;
+        evaluateDependents(input.slot);
+        if (input.stale)
+        {
+            input.stale = false;
+            refreshFunctional(in);
+        }
+    }
+
+    void markStale(uint32_t in)
+    {
+        auto& input = inputs_[in];
+        if (input.stale)
+        {
+            return;
+        }
+        input.stale = true;
+        live_[input.slot] = std::numeric_limits<double>::quiet_NaN();
+
+        ++pass_;
+        evaluateDependents(input.slot);
+        refreshFunctional(in);
+    }
+
+    // Input values as sensor `sensor` sees them under its StalePolicy
+    std::span<const double> valuesFor(const VirtualSensor& sensor) const
+    {
+        return sensor.config().stalePolicy ==
+                       virtual_sensor::StalePolicy::exclude
+                   ? live_
+                   : values_;
+    }
+
+    // Functional: every input the sensor reads is fresh
+    void updateFunctional(uint32_t index)
+    {
+        bool functional = true;
+        for (auto slot : sensors_[index]->program().inputs())
+        {
+            functional = functional && !inputs_[owners_[slot]].stale;
+        }
+        sensors_[index]->setFunctional(functional);
+    }
+
+    // Re-check Functional of the sensors reading any slot of input `in`
+    void refreshFunctional(uint32_t in)
+    {
+        const auto& input = inputs_[in];
+        auto refresh = [this](uint32_t slot) {
+            for (auto index : dependents_[slot])
+            {
+                updateFunctional(index);
+            }
+        };
+        refresh(input.slot);
+        if (input.stats)
+        {
+            for (auto slot : input.statSlots)
+            {
+                if (slot != expression::npos)
+                {
+                    refresh(slot);
+                }
+            }
+        }
+    }
+
+    // Feed the current value to the window and refresh the used stat slots
+    void sample(uint32_t in)
+    {
+        auto& input = inputs_[in];
+        input.stats->add(Clock::now(), live_[input.slot]); // stale: skipped
+
+        ++pass_;
+        for (size_t stat = 0; stat < WindowStats::statCount; ++stat)
+        {
+            auto slot = input.statSlots[stat];
+            if (slot == expression::npos)
+            {
+                continue;
+            }
+            double value =
+                input.stats->get(static_cast<WindowStats::Stat>(stat));
+            if (value == values_[slot] ||
+                (std::isnan(value) && std::isnan(values_[slot])))
+            {
+                continue;
+            }
+            values_[slot] = value;
+            live_[slot] = value;
+            evaluateDependents(slot);
+        }
+    }
+
+    // Evaluate each sensor reading `slot`, at most once per pass_
+    void evaluateDependents(uint32_t slot)
+    {
+        for (auto index : dependents_[slot])
+        {
+            if (marks_[index] != pass_)
+            {
+                marks_[index] = pass_;
+                if (sensors_[index]->evaluate(valuesFor(*sensors_[index])))
+                {
+                    queue(index);
+                }
+            }
+        }
+    }
+
+    // Have `index` considered for a signal once this loop iteration's
+    // handlers are done
+    void queue(uint32_t index)
+    {
+        if (queued_[index])
+        {
+            return;
+        }
+        queued_[index] = true;
+        queue_.push_back(index);
+        if (!flushPosted_)
+        {
+            flushPosted_ = true;
+            boost::asio::post(conn_->get_io_context(), [this]() { flush(); });
+        }
+    }
+
+    void flush()
+    {
+        flushPosted_ = false;
+        syncWheel();
+        auto now = Clock::now();
+        for (auto index : queue_)
+        {
+            queued_[index] = false;
+            emit(index, now);
+        }
+        queue_.clear();
+        scheduleClock();
+    }
+
+    /**
+     * Signal sensor `index` if its EmitPolicy allows it at `now`, and arm
+     * its timer for the next moment that might: the end of the minimum
+     * interval if a change is being held back, else the next heartbeat.
+     * Also the timer's callback, so it re-checks rather than trusting the
+     * wheel's tick rounding.
+     */
+    void emit(uint32_t index, Clock::time_point now)
+    {
+        auto& sensor = *sensors_[index];
+        const auto& policy = sensor.config().emit;
+        auto since = now - sensor.lastSignal();
+        bool changed = sensor.outsideDeadband();
+        // A heartbeat repeats the last signal, so needs one to repeat
+        bool heartbeat = policy.heartbeat.count() > 0 &&
+                         sensor.signals() > 0 && since >= policy.heartbeat;
+
+        if (changed && !heartbeat && since < policy.minInterval)
+        {
+            armAfter(emitTimers_[index], policy.minInterval - since);
+            return;
+        }
+        if (changed || heartbeat)
+        {
+            sensor.signal(now);
+            since = Clock::duration::zero();
+        }
+        if (policy.heartbeat.count() > 0 && sensor.signals() > 0)
+        {
+            armAfter(emitTimers_[index], policy.heartbeat - since);
+        }
+    }
+
+    // Fire wheel timer `id` no earlier than `delay` from now
+    void armAfter(TimerWheel::Id id, Clock::duration delay)
+    {
+        // +1: the wheel's current tick may already be partly over
+        auto ticks = (std::max(delay, Clock::duration::zero()) + tick_ -
+                      Clock::duration(1)) /
+                         tick_ +
+                     1;
+        wheel_.arm(id, static_cast<uint64_t>(ticks));
+    }
+
+    // Re-read input `in` every `interval`; the shortest interval asked wins
+    void poll(uint32_t in, std::chrono::milliseconds interval)
+    {
+        auto& input = inputs_[in];
+        uint64_t ticks = std::max<uint64_t>(interval / tick_, 1);
+        if (input.poll != TimerWheel::npos && input.pollTicks <= ticks)
+        {
+            return;
+        }
+        if (input.poll == TimerWheel::npos)
+        {
+            input.poll = wheel_.add([this, in]() {
+                wheel_.arm(inputs_[in].poll, inputs_[in].pollTicks);
+                read(in);
+            });
+            ++polled_;
+        }
+        input.pollTicks = ticks;
+
+        syncWheel();
+        wheel_.arm(input.poll, ticks);
+        scheduleClock();
+    }
+
+    // Catch the wheel up with the wall clock, firing what fell due
+    void syncWheel()
+    {
+        auto elapsed = static_cast<uint64_t>((Clock::now() - epoch_) / tick_);
+        if (elapsed > wheel_.now())
+        {
+            wheel_.advance(elapsed - wheel_.now());
+        }
+    }
+
+    // Sleep until the next wheel slot that can hold a due timer
+    void scheduleClock()
+    {
+        if (wheel_.armedCount() == 0)
+        {
+            clock_.cancel();
+            return;
+        }
+        clock_.expires_at(epoch_ +
+                          tick_ * (wheel_.now() + wheel_.ticksUntilNext()));
+        clock_.async_wait([this](const boost::system::error_code& ec) {
+            if (ec)
+            {
+                return; // rescheduled or shutting down
+            }
+            syncWheel();
+            scheduleClock();
+        });
+    }
+
+    std::shared_ptr<sdbusplus::asio::connection> conn_;
+    sdbusplus::asio::object_server server_;
+
+    std::vector<Input> inputs_;
+    std::unordered_map<std::string, uint32_t> inputByPath_;
+    std::vector<Service> services_;
+    std::unordered_map<std::string, uint32_t> serviceByName_;
+    size_t polled_ = 0;
+
+    // Value slots: every input value and every statistic in use. Each slot
+    // lists the sensors reading it and the input it is derived from.
+    // live_ matches values_ except that stale inputs read NaN there.
+    std::vector<double> values_;
+    std::vector<double> live_;
+    std::vector<std::vector<uint32_t>> dependents_;
+    std::vector<uint32_t> owners_;
+
+    std::vector<std::unique_ptr<VirtualSensor>> sensors_;
+    std::vector<uint64_t> marks_; // per sensor: pass_ it was last evaluated
+    uint64_t pass_ = 0;
+
+    // Sensors whose value moved since the last flush()
+    std::vector<uint32_t> queue_;
+    std::vector<bool> queued_;
+    bool flushPosted_ = false;
+    std::vector<TimerWheel::Id> emitTimers_; // npos unless policy is timed
+
+    TimerWheel wheel_;
+    boost::asio::steady_timer clock_;
+    const std::chrono::milliseconds tick_;
+    const Clock::time_point epoch_;
+};
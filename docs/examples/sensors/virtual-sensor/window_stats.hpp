@@ -0,0 +1,324 @@
+/**
+ * Windowed Input Statistics
+ *
+ * Rolling statistics over the most recent samples of one sensor input:
+ * min, max, mean, EWMA and percentiles. They feed expressions like
+ * `psu0.ewma + psu1.ewma` (see virtual_sensor.hpp).
+ *
+ * Samples go into a preallocated ring of `capacity` entries. A sample
+ * leaves the window when it is older than the configured duration or when
+ * the ring is full; the newest sample is never aged out. The manager
+ * feeds the current value at a fixed period (window / capacity) rather
+ * than on every change, so a value that holds for a long time weighs
+ * accordingly. Per sample:
+ *   - min and max come from monotonic deques (fixed index rings), O(1)
+ *     amortized;
+ *   - the mean uses a running sum, re-added from scratch every `capacity`
+ *     evictions so rounding error cannot build up;
+ *   - the EWMA uses time constant `tau`: alpha = 1 - exp(-dt / tau);
+ *   - percentiles are exact over the window, computed only on request
+ *     with nth_element on a stack copy.
+ * Nothing allocates after construction.
+ *
+ * The owning (io) thread calls add() and the plain accessors. Any other
+ * thread, e.g. a metrics exporter, reads a consistent copy with
+ * snapshot(). That is a seqlock: the writer never blocks, and a reader
+ * retries only if a sample lands while it is copying.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <thread>
+
+class WindowStats
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t capacity = 256; // power of two
+
+    enum class Stat : uint8_t
+    {
+        min,
+        max,
+        mean,
+        ewma,
+        p50,
+        p90,
+        p95,
+        p99
+    };
+    static constexpr size_t statCount = 8;
+
+    // Consistent copy for readers on other threads
+    struct Snapshot
+    {
+        uint32_t count = 0;
+        double last = std::numeric_limits<double>::quiet_NaN();
+        double min = std::numeric_limits<double>::quiet_NaN();
+        double max = std::numeric_limits<double>::quiet_NaN();
+        double mean = std::numeric_limits<double>::quiet_NaN();
+        double ewma = std::numeric_limits<double>::quiet_NaN();
+        std::array<double, capacity> samples; // first `count`, oldest first
+
+        double percentile(double p) const
+        {
+            auto copy = samples;
+            return WindowStats::percentile(copy.data(), count, p);
+        }
+    };
+
+    WindowStats(Clock::duration window, Clock::duration tau) :
+        window_(window), tau_(std::chrono::duration<double>(tau).count())
+    {}
+
+    WindowStats(const WindowStats&) = delete;
+    WindowStats& operator=(const WindowStats&) = delete;
+
+    // Add one sample; NaN (unavailable) is ignored
+    void add(Clock::time_point time, double value)
+    {
+        if (std::isnan(value))
+        {
+            return;
+        }
+        auto seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        // Age out, always keeping the newest sample
+        while (size_ > 1 && times_[slot(oldest())] < time - window_)
+        {
+            evict();
+        }
+        if (size_ == capacity)
+        {
+            evict();
+        }
+        updateEwma(time, value);
+        push(time, value);
+        publish();
+
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    uint32_t count() const
+    {
+        return size_;
+    }
+
+    // Owning thread only
+    double get(Stat stat) const
+    {
+        if (size_ == 0)
+        {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        switch (stat)
+        {
+            case Stat::min:
+                return valueAt(minQueue_[minHead_ % capacity]);
+            case Stat::max:
+                return valueAt(maxQueue_[maxHead_ % capacity]);
+            case Stat::mean:
+                return sum_ / size_;
+            case Stat::ewma:
+                return ewma_;
+            case Stat::p50:
+                return ownPercentile(50);
+            case Stat::p90:
+                return ownPercentile(90);
+            case Stat::p95:
+                return ownPercentile(95);
+            case Stat::p99:
+                return ownPercentile(99);
+        }
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    // Any thread; lock-free for the writer
+    Snapshot snapshot() const
+    {
+        Snapshot snap;
+        while (true)
+        {
+            auto begin = seq_.load(std::memory_order_acquire);
+            if (begin & 1)
+            {
+                std::this_thread::yield(); // writer mid-update
+                continue;
+            }
+            snap.count = count_.load(std::memory_order_relaxed);
+            snap.last = last_.load(std::memory_order_relaxed);
+            snap.min = min_.load(std::memory_order_relaxed);
+            snap.max = max_.load(std::memory_order_relaxed);
+            snap.mean = mean_.load(std::memory_order_relaxed);
+            snap.ewma = ewmaOut_.load(std::memory_order_relaxed);
+            uint32_t first = first_.load(std::memory_order_relaxed);
+            for (uint32_t i = 0; i < snap.count && i < capacity; ++i)
+            {
+                snap.samples[i] = values_[slot(first + i)].load(
+                    std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == begin)
+            {
+                return snap;
+            }
+        }
+    }
+
+    // Value at percentile `p` of the first `n` entries of `data`
+    // (reordered in place)
+    static double percentile(double* data, size_t n, double p)
+    {
+        if (n == 0)
+        {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        auto rank = static_cast<size_t>(std::ceil(p / 100.0 * n));
+        rank = std::clamp<size_t>(rank, 1, n) - 1;
+        std::nth_element(data, data + rank, data + n);
+        return data[rank];
+    }
+
+  private:
+    static size_t slot(uint32_t seq)
+    {
+        return seq & (capacity - 1);
+    }
+
+    uint32_t oldest() const
+    {
+        return next_ - size_;
+    }
+
+    double valueAt(uint32_t seq) const
+    {
+        return values_[slot(seq)].load(std::memory_order_relaxed);
+    }
+
+    void evict()
+    {
+        uint32_t seq = oldest();
+        sum_ -= valueAt(seq);
+        if (minTail_ != minHead_ && minQueue_[minHead_ % capacity] == seq)
+        {
+            ++minHead_;
+        }
+        if (maxTail_ != maxHead_ && maxQueue_[maxHead_ % capacity] == seq)
+        {
+            ++maxHead_;
+        }
+        --size_;
+
+        if (++evictions_ % capacity == 0)
+        {
+            sum_ = 0.0;
+            for (uint32_t s = oldest(); s != next_; ++s)
+            {
+                sum_ += valueAt(s);
+            }
+        }
+    }
+
+    void push(Clock::time_point time, double value)
+    {
+        uint32_t seq = next_++;
+        values_[slot(seq)].store(value, std::memory_order_relaxed);
+        times_[slot(seq)] = time;
+        sum_ += value;
+        ++size_;
+
+        // Drop entries that can never again be the min (or max)
+        while (minTail_ != minHead_ &&
+               valueAt(minQueue_[(minTail_ - 1) % capacity]) >= value)
+        {
+            --minTail_;
+        }
+        minQueue_[minTail_++ % capacity] = seq;
+        while (maxTail_ != maxHead_ &&
+               valueAt(maxQueue_[(maxTail_ - 1) % capacity]) <= value)
+        {
+            --maxTail_;
+        }
+        maxQueue_[maxTail_++ % capacity] = seq;
+    }
+
+    void updateEwma(Clock::time_point time, double value)
+    {
+        if (std::isnan(ewma_))
+        {
+            ewma_ = value;
+        }
+        else
+        {
+            double dt = std::chrono::duration<double>(time - lastTime_).count();
+            double alpha = tau_ > 0.0 ? 1.0 - std::exp(-dt / tau_) : 1.0;
+            ewma_ += alpha * (value - ewma_);
+        }
+        lastTime_ = time;
+        lastValue_ = value;
+    }
+
+    double ownPercentile(double p) const
+    {
+        std::array<double, capacity> copy;
+        for (uint32_t i = 0; i < size_; ++i)
+        {
+            copy[i] = valueAt(oldest() + i);
+        }
+        return percentile(copy.data(), size_, p);
+    }
+
+    // Copy the summary to the atomics snapshot() reads
+    void publish()
+    {
+        count_.store(size_, std::memory_order_relaxed);
+        first_.store(oldest(), std::memory_order_relaxed);
+        last_.store(lastValue_, std::memory_order_relaxed);
+        min_.store(get(Stat::min), std::memory_order_relaxed);
+        max_.store(get(Stat::max), std::memory_order_relaxed);
+        mean_.store(get(Stat::mean), std::memory_order_relaxed);
+        ewmaOut_.store(ewma_, std::memory_order_relaxed);
+    }
+
+    const Clock::duration window_;
+    const double tau_; // seconds
+
+    // Writer state
+    std::array<Clock::time_point, capacity> times_{};
+    uint32_t next_ = 0; // sequence number of the next sample
+    uint32_t size_ = 0;
+    double sum_ = 0.0;
+    uint64_t evictions_ = 0;
+    double ewma_ = std::numeric_limits<double>::quiet_NaN();
+    double lastValue_ = std::numeric_limits<double>::quiet_NaN();
+    Clock::time_point lastTime_{};
+
+    // Monotonic deques of sample sequence numbers: values increase from
+    // head to tail in minQueue_ and decrease in maxQueue_
+    std::array<uint32_t, capacity> minQueue_{};
+    std::array<uint32_t, capacity> maxQueue_{};
+    uint32_t minHead_ = 0, minTail_ = 0;
+    uint32_t maxHead_ = 0, maxTail_ = 0;
+
+    // Shared with snapshot() readers, guarded by seq_
+    std::atomic<uint64_t> seq_{0};
+    std::array<std::atomic<double>, capacity> values_{};
+    std::atomic<uint32_t> count_{0};
+    std::atomic<uint32_t> first_{0};
+    std::atomic<double> last_{std::numeric_limits<double>::quiet_NaN()};
+    std::atomic<double> min_{std::numeric_limits<double>::quiet_NaN()};
+    std::atomic<double> max_{std::numeric_limits<double>::quiet_NaN()};
+    std::atomic<double> mean_{std::numeric_limits<double>::quiet_NaN()};
+    std::atomic<double> ewmaOut_{std::numeric_limits<double>::quiet_NaN()};
+};